@@ -339,6 +339,57 @@ public:
     }
 
 
+    /// <summary>
+    /// 2D noise over a regular grid using current settings, written row-major into output
+    /// </summary>
+    /// <remarks>
+    /// output[y * xSize + x] matches GetNoise(xStart + x * xStep, yStart + y * yStep)
+    /// to within float rounding. The frequency and skew transform is linear, so it
+    /// is set up once for the grid and stepped per sample, and the fractal type is
+    /// resolved once per row instead of per sample.
+    /// </remarks>
+    template <typename FNfloat>
+    void GetNoiseGrid(float* output, FNfloat xStart, FNfloat yStart, int xSize, int ySize, FNfloat xStep, FNfloat yStep) const
+    {
+        Arguments_must_be_floating_point_values<FNfloat>();
+
+        // Transformed step along a row and down a column
+        FNfloat rowStepX = xStep, rowStepY = 0;
+        FNfloat colStepX = 0, colStepY = yStep;
+        TransformNoiseCoordinate(rowStepX, rowStepY);
+        TransformNoiseCoordinate(colStepX, colStepY);
+
+        FNfloat originX = xStart, originY = yStart;
+        TransformNoiseCoordinate(originX, originY);
+
+        for (int y = 0; y < ySize; y++)
+        {
+            FNfloat rowX = originX + colStepX * y;
+            FNfloat rowY = originY + colStepY * y;
+            float* row = output + (size_t)y * xSize;
+
+            switch (mFractalType)
+            {
+            default:
+                for (int x = 0; x < xSize; x++)
+                    row[x] = GenNoiseSingle(mSeed, rowX + rowStepX * x, rowY + rowStepY * x);
+                break;
+            case FractalType_FBm:
+                for (int x = 0; x < xSize; x++)
+                    row[x] = GenFractalFBm(rowX + rowStepX * x, rowY + rowStepY * x);
+                break;
+            case FractalType_Ridged:
+                for (int x = 0; x < xSize; x++)
+                    row[x] = GenFractalRidged(rowX + rowStepX * x, rowY + rowStepY * x);
+                break;
+            case FractalType_PingPong:
+                for (int x = 0; x < xSize; x++)
+                    row[x] = GenFractalPingPong(rowX + rowStepX * x, rowY + rowStepY * x);
+                break;
+            }
+        }
+    }
+
     /// <summary>
     /// 2D warps the input position using current domain warp settings
     /// </summary>
@@ -394,6 +445,9 @@ public:
     }
 
 private:
+    // Vector kernels in noise_simd.h mirror the scalar code, so they read the settings directly
+    friend struct NoiseSimd;
+
     template <typename T>
     struct Arguments_must_be_floating_point_values;
 
@@ -1,5 +1,6 @@
 //STD
 #include <iostream>
+#include <memory>
 
 //GLAD
 #include <glad/glad.h>
@@ -20,6 +21,15 @@
 //GENERAL
 #include "main.h"
 #include "terrain.h"
+#include "instancing.h"
+#include "scene.h"
+#include "renderqueue.h"
+#include "bvh.h"
+#include "gpuscene.h"
+#include "occlusion.h"
+#include "camera.h"
+#include "shaderprogram.h"
+#include "modelloader.h"
 
 using namespace std;
 using namespace glm;
@@ -77,6 +87,9 @@ float cameraLastYPos = 600.0f / 2.0f;
 // projection : camera ? clip space
 //
 // mvp = projection * view * model
+//
+// view and projection reach the shaders through the Camera block (camera.h);
+// only model is set per draw, and mvp is kept for CPU-side culling.
 // -----------------------------------------------------------------------------
 mat4 mvp;
 mat4 model;
@@ -89,363 +102,6 @@ mat4 projection;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-// -----------------------------------------------------------------------------
-// WORLD & ASSET SCALE SYSTEM
-//
-// WORLD_SCALE defines what "1 unit" means in the scene.
-// All asset scales should be relative to this.
-//
-// If WORLD_SCALE changes later, everything scales consistently.
-// -----------------------------------------------------------------------------
-constexpr float WORLD_SCALE = 1.0f;
-
-// Asset-specific scale values (relative to WORLD_SCALE)
-constexpr float CAVE_SCALE = WORLD_SCALE * 0.5f;
-constexpr float PLATFORM_SCALE = WORLD_SCALE * 1.5f;
-constexpr float RUIN_SCALE = WORLD_SCALE * 1.0f;
-constexpr float STATUE_SCALE = WORLD_SCALE * 0.2f;
-
-// ---------------------------------------------------------------------
-// SCENE ANCHOR
-// ---------------------------------------------------------------------
-const vec3 LEVEL_OFFSET = vec3(0.0f, -30.0f, 50.0f);
-
-// Converts Blender world coordinates to OpenGL world coordinates
-// Blender: X = left/right, Y = forward, Z = up
-// OpenGL:  X = left/right, Y = up,      Z = -forward
-vec3 BlenderToOpenGL(float bx, float by, float bz)
-{
-    return vec3(
-        bx,     // X stays X
-        bz,     // Blender Z (up) -> OpenGL Y (up)
-        -by      // Blender Y (forward) -> OpenGL -Z (forward)
-    );
-}
-
-// 
-struct InstanceTransform
-{
-    vec3 position;     // OpenGL world position
-    float rotationY;   // Y-axis rotation in degrees (Blender Z)
-    vec3 scale;        // Usually uniform
-};
-
-// -----------------------------------------------------------------------------
-// Asset locations
-// -----------------------------------------------------------------------------
-
-std::vector<InstanceTransform> caveWall1_APositions = {
-    {
-        BlenderToOpenGL(16.82f, 96.48f, 0.00f),
-        0.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(42.46f, 86.03f, 0.00f),
-        0.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(27.51f, 120.49f, 0.00f),
-        0.00f,
-        vec3(CAVE_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> caveWall1_BPositions = {
-    {
-        BlenderToOpenGL(-2.81f, 138.38f, 0.00f),
-        199.00f,
-        vec3(CAVE_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> caveWall1_CPositions = {
-    {
-        BlenderToOpenGL(3.95f, 66.21f, 0.00f),
-        60.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(-57.57f, 149.02f, 0.00f),
-        60.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(-38.99f, 113.24f, 0.00f),
-        158.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(80.91f, 149.79f, 0.00f),
-        -13.00f,
-        vec3(CAVE_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> caveWall1_DPositions = {
-    {
-        BlenderToOpenGL(-11.23f, 125.48f, 0.00f),
-        69.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(-19.33f, 104.81f, 0.00f),
-        159.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(59.19f, 150.46f, 0.00f),
-        340.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(-56.86f, 129.93f, 0.00f),
-        159.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(80.85f, 77.62f, 0.00f),
-        249.00f,
-        vec3(CAVE_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> caveWall2_APositions = {
-    {
-        BlenderToOpenGL(0.00f, 0.00f, 0.00f),
-        0.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(49.74f, 140.21f, 0.00f),
-        163.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(18.31f, 65.78f, 0.00f),
-        152.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(73.03f, 86.96f, 0.00f),
-        248.75f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(-2.98f, 119.03f, 0.00f),
-        248.00f,
-        vec3(CAVE_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> caveWall2_BPositions = {
-    {
-        BlenderToOpenGL(21.24f, -13.29f, 0.00f),
-        294.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(-22.12f, -13.29f, 0.00f),
-        242.00f,
-        vec3(CAVE_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> caveWall2_CPositions = {
-    {
-        BlenderToOpenGL(50.12f, 66.44f, 0.00f),
-        250.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(71.21f, 119.85f, 0.00f),
-        340.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(-0.34f, 89.78f, 0.00f),
-        160.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(19.94f, 137.42f, 0.00f),
-        70.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(99.52f, 129.61f, 0.00f),
-        340.00f,
-        vec3(CAVE_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> caveWall3Positions = {
-    {
-        BlenderToOpenGL(-12.00f, 32.00f, 0.00f),
-        75.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(19.00f, 32.00f, 0.00f),
-        75.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(24.44f, 169.37f, 0.00f),
-        354.00f,
-        vec3(CAVE_SCALE)
-    },
-    {
-        BlenderToOpenGL(100.01f, 96.51f, 0.00f),
-        67.00f,
-        vec3(CAVE_SCALE)
-    }
-};
-
-
-std::vector<InstanceTransform> caveWall4_APositions = {
-    {
-        BlenderToOpenGL(-35.79f, 162.31f, 0.00f),
-        13.00f,
-        vec3(CAVE_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> caveWall4_DPositions = {
-    {
-        BlenderToOpenGL(53.34f, 107.70f, -5.03f),
-        0.00f,
-        vec3(CAVE_SCALE)
-    }
-};
-
-// Platforms -- ceiling
-
-std::vector<InstanceTransform> cavePlatform2_1Positions = {
-    {
-        BlenderToOpenGL(4.76f, 28.36f, 14.50f),
-        279.00f,
-        vec3(PLATFORM_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> cavePlatform2_2Positions = {
-    {
-        BlenderToOpenGL(15.93f, 154.37f, 15.00f),
-        29.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(-38.04f, 139.17f, 14.00f),
-        41.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(62.10f, 133.82f, 14.00f),
-        221.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(86.50f, 126.87f, 15.00f),
-        128.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(60.87f, 84.09f, 14.50f),
-        242.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(4.83f, 110.31f, 14.50f),
-        221.00f,
-        vec3(PLATFORM_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> cavePlatform2_4Positions = {
-    {
-        BlenderToOpenGL(22.04f, 77.04f, 14.00f),
-        40.00f,
-        vec3(PLATFORM_SCALE)
-    }
-};
-
-
-// Platforms -- floors
-
-std::vector<InstanceTransform> cavePlatform2_2FloorPositions = {
-    {
-        BlenderToOpenGL(15.93f, 154.37f, -14.99f),
-        29.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(-38.04f, 139.17f, -15.99f),
-        41.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(62.10f, 133.82f, -15.99f),
-        221.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(86.50f, 126.87f, -14.99f),
-        128.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(60.87f, 84.09f, -15.49f),
-        242.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(4.83f, 110.31f, -15.49f),
-        221.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(6.18f, 35.50f, -14.99f),
-        117.00f,
-        vec3(PLATFORM_SCALE)
-    }
-};
-
-std::vector<InstanceTransform> cavePlatform2_4FloorPositions = {
-    {
-        BlenderToOpenGL(22.04f, 77.04f, -14.64f),
-        40.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(32.27f, 57.62f, -14.14f),
-        40.00f,
-        vec3(PLATFORM_SCALE)
-    },
-    {
-        BlenderToOpenGL(45.00f, 123.82f, -13.96f),
-        -21.00f,
-        vec3(PLATFORM_SCALE)
-    }
-};
-
-
-
-// Temple
-std::vector<InstanceTransform> templePositions = {
-    {
-        BlenderToOpenGL(-36.20f, 122.53f, -7.33f),
-        116.00f,
-        vec3(RUIN_SCALE)
-    },
-    {
-        BlenderToOpenGL(-52.09f, 135.41f, -7.33f),
-        26.00f,
-        vec3(RUIN_SCALE)
-    }
-};
-
 
 
 
@@ -504,45 +160,101 @@ int main()
     terrainBowl.bowlDepth = -40.0f;
     terrainBowl.bowlHeight = 60.0f;
     terrainBowl.center = glm::vec2(1024.0f, 1024.0f);
+    terrainBowl.duneHeight = 6.0f;
+    terrainBowl.mode = TerrainMode::Mesh;   // TerrainMode::Clipmap for camera-following rings
+    terrainBowl.vertexFormat = TerrainVertexFormat::Compact;
+    terrainBowl.useLod = true;
 
     InitialiseTerrain(terrainCap, true);   // inverted
     InitialiseTerrain(terrainBowl, false); // normal bowl
 
+    PrintTerrainMemory("cap", terrainCap);
+    PrintTerrainMemory("bowl", terrainBowl);
+    PrintTerrainVertexCache("bowl", terrainBowl);
+
 
     // -------------------------------------------------------------------------
     // SHADERS & MODELS
     //
     // LearnOpenGL handles VAOs/VBOs internally for models.
+    // Uniform names are resolved to handles here, once, not per draw.
     // -----------------------------------------------------------------------------
-    Shader Shaders("shaders/vertexShader.vert", "shaders/fragmentShader.frag");
-	Shader terrainShaders("shaders/terrain.vert", "shaders/terrain.frag");
-    // Cave walls 
-    Model CaveWall1_A("media/cave/CaveWalls1/CaveWalls1_A.obj");
-    Model CaveWall1_B("media/cave/CaveWalls1/CaveWalls1_B.obj");
-    Model CaveWall1_C("media/cave/CaveWalls1/CaveWalls1_C.obj");
-    Model CaveWall1_D("media/cave/CaveWalls1/CaveWalls1_D.obj");
+    ShaderProgram Shaders;
+    ShaderProgram terrainShaders;
+    if (!LoadShaderProgram(Shaders, "shaders/vertexShader.vert", "shaders/fragmentShader.frag") ||
+        !LoadShaderProgram(terrainShaders, "shaders/terrain.vert", "shaders/terrain.frag"))
+    {
+        glfwTerminate();
+        return -1;
+    }
 
-	Model CaveWall2_A("media/cave/CaveWalls2/CaveWalls2_A.obj"); 
-	Model CaveWall2_B("media/cave/CaveWalls2/CaveWalls2_B.obj");
-	Model CaveWall2_C("media/cave/CaveWalls2/CaveWalls2_C.obj"); 
+    TerrainUniforms terrainUniforms = FindTerrainUniforms(terrainShaders);
+    // -------------------------------------------------------------------------
+    // SCENE
+    //
+    // Which models go where comes from the scene file. Each model gets one
+    // instance buffer holding every placement of it, so it costs one draw per
+    // mesh however often it is placed.
+    // -------------------------------------------------------------------------
+    Scene scene;
+    if (!LoadScene("media/scene/cave.scene", scene))
+    {
+        glfwTerminate();
+        return -1;
+    }
+
+    // World matrices and bounds are built here, once - placements only get
+    // rebuilt if they are marked dirty
+    const mat4 levelAnchor = translate(mat4(1.0f), scene.anchor);
 
-	Model CaveWall3("media/cave/CaveWalls3/CaveWalls3.obj");
+    // Imported and decoded on every core, uploaded here as each one is ready.
+    // Textures shared between models are decoded and uploaded once, and are
+    // block compressed into <image>.ktx2 the first time they are loaded.
+    // Models don't move once loaded - sceneModels keeps pointers to them
+    std::vector<std::string> modelPaths;
+    for (const SceneModel& sceneModel : scene.models)
+        modelPaths.push_back(sceneModel.path);
 
-	Model CaveWall4_A("media/cave/CaveWalls4/CaveWalls4_A.obj"); 
-	Model CaveWall4_B("media/cave/CaveWalls4/CaveWalls4_B.obj"); 
-	Model CaveWall4_C("media/cave/CaveWalls4/CaveWalls4_C.obj"); 
-	Model CaveWall4_D("media/cave/CaveWalls4/CaveWalls4_D.obj"); 
+    TextureCache textureCache;
+    InitialiseTextureCache(textureCache, false);   // true for BC7 colour instead of BC1/BC3
+    std::vector<std::unique_ptr<ModelAsset>> models;
+    LoadModels(modelPaths, models, textureCache);
+    PrintTextureCacheStats(textureCache);
 
-	// Cave platforms
-    Model CavePlatform2_1("media/cave/CavePlatform2/CavePlatform2_1.obj");
-	Model CavePlatform2_2("media/cave/CavePlatform2/CavePlatform2_2.obj"); 
-	Model CavePlatform2_3("media/cave/CavePlatform2/CavePlatform2_3.obj");
-	Model CavePlatform2_4("media/cave/CavePlatform2/CavePlatform2_4.obj"); 
+    std::vector<InstancedModel> sceneModels;
 
-    // Ruins
-	Model TempleOfApollo("media/ruins/temple of apollo.obj");
+    for (size_t i = 0; i < scene.models.size(); i++)
+    {
+        InstancedModel instanced;
+        InitialiseInstancedModel(instanced, *models[i], levelAnchor, ScenePlacements(scene, scene.models[i]));
+        sceneModels.push_back(instanced);
+    }
 
-    Shaders.use();
+    // Culling hierarchy over every placement's world bounds
+    InstanceBvh sceneBvh;
+    BuildInstanceBvh(sceneBvh, sceneModels);
+
+    std::vector<BvhItem> visibleItems;
+    std::vector<std::vector<int>> visiblePlacements(sceneModels.size());
+
+    // Every mesh of every model in one buffer, drawn with one call. Hidden
+    // placements are then dropped on the GPU; if either is unavailable the
+    // models are drawn one mesh at a time / everything in the frustum is drawn.
+    GpuScene gpuScene;
+    InitialiseGpuScene(gpuScene, sceneModels);
+
+    OcclusionCuller occlusion;
+    InitialiseOcclusionCuller(occlusion, gpuScene, sceneModels, windowWidth, windowHeight);
+
+    // The scene samples its own copies of the textures, so the models' are
+    // only held by meshes that will never be drawn
+    if (gpuScene.enabled)
+    {
+        for (std::unique_ptr<ModelAsset>& model : models)
+            ReleaseModelTextures(*model, textureCache);
+    }
+
+    UseShaderProgram(Shaders);
 
     // -------------------------------------------------------------------------
     // VIEWPORT & CALLBACKS
@@ -570,6 +282,11 @@ int main()
     // -------------------------------------------------------------------------
     // RENDER LOOP
     // -----------------------------------------------------------------------------
+    RenderQueue renderQueue;
+
+    CameraBuffer cameraBuffer;
+    InitialiseCameraBuffer(cameraBuffer);
+
     while (!glfwWindowShouldClose(window))
     {
         // Time step
@@ -595,226 +312,97 @@ int main()
             cameraPosition + cameraFront,
             cameraUp
         );
+
+        // One upload serves every program drawn this frame
+        UpdateCameraBuffer(cameraBuffer, view, projection, cameraPosition);
         
         // ---------------------------------------------------------------------
         // TERRAIN
         // ---------------------------------------------------------------------
-        terrainShaders.use();
+        UseShaderProgram(terrainShaders);
 
         // Large bowl first
         model = mat4(1.0f);
         model = translate(model, vec3(-terrainBowl.center.x, 0.0f, -terrainBowl.center.y));
-        SetMatrices(terrainShaders);
-        DrawTerrain(terrainBowl);
+        SetMatrices(terrainShaders, terrainUniforms.model);
+        DrawTerrain(terrainBowl, terrainShaders, terrainUniforms, mvp, vec3(inverse(model) * vec4(cameraPosition, 1.0f)));
 
         // Cap on top
         //model = mat4(1.0f);
         //model = translate(model, vec3(-terrainCap.center.x, 0.0f, -terrainCap.center.y));
-        //SetMatrices(terrainShaders);
-        //DrawTerrain(terrainCap);
+        //SetMatrices(terrainShaders, terrainUniforms.model);
+        //DrawTerrain(terrainCap, terrainShaders, terrainUniforms, mvp, vec3(inverse(model) * vec4(cameraPosition, 1.0f)));
 
 
-        // -------------------------------------------------------------------------
-        // MODEL TRANSFORM REFERENCE
-        //
-        // Standard per-object transform order:
-        //
-        // model = mat4(1.0f);                      // Reset to WORLD space
-		// model = transform(model, LEVEL_OFFSET);  // Level anchor point
-        // model = translate(model, position);      // Place object in world
-        // model = rotate(model, angle, axis);      // Optional rotation
-		// model = scale(model, instance.scale);    // Uniform/non-uniform scale
-		// SetMatrices(Shaders);                    // Upload to GPU
-		// object.Draw(Shaders);                    // Render object
-        //
-        // IMPORTANT:
-        // - Always reset model per object
-        // - Never "undo" transforms  reset instead
-        // -----------------------------------------------------------------------------
-
         // ---------------------------------------------------------------------
-        // CAVE WALLS 
+        // CAVE WALLS, PLATFORMS & RUINS
+        //
+        // World matrices come from the instance buffers, so only the camera
+        // goes up per frame - static placements cost a dirty check each.
+        // The BVH picks the placements inside the view, the occlusion pass
+        // drops the ones hidden behind others, and the whole scene goes out
+        // in one multi-draw. Without it, meshes go through the render queue,
+        // which orders them by program, texture set and VAO before drawing.
         // ---------------------------------------------------------------------
-        Shaders.use();
-
-        for (const auto& instance : caveWall1_APositions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET); 
-			model = translate(model, instance.position);
-			model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-			model = scale(model, instance.scale);
-			SetMatrices(Shaders);
-			CaveWall1_A.Draw(Shaders);
-        }
-
-        for (const auto& instance : caveWall1_BPositions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET); 
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CaveWall1_B.Draw(Shaders);
-        }
-        
-        for (const auto& instance : caveWall1_CPositions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET); 
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CaveWall1_C.Draw(Shaders);
-        }
-
-        for (const auto& instance : caveWall1_DPositions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CaveWall1_D.Draw(Shaders);
-        }
-
-        for (const auto& instance : caveWall2_APositions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CaveWall2_A.Draw(Shaders);
-        }
-
-        for (const auto& instance : caveWall2_BPositions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CaveWall2_B.Draw(Shaders);
-        }
-
-        for (const auto& instance : caveWall2_CPositions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CaveWall2_C.Draw(Shaders);
-        }
-
-        for (const auto& instance : caveWall3Positions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CaveWall3.Draw(Shaders);
-        }
-
-        for (const auto& instance : caveWall4_APositions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CaveWall4_A.Draw(Shaders);
-        }
-
-        for (const auto& instance : caveWall4_DPositions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CaveWall4_D.Draw(Shaders);
-        }
+        bool placementsMoved = false;
+        for (InstancedModel& instanced : sceneModels)
+            placementsMoved |= RefreshInstances(instanced);
 
-        // Platforms
-        for (const auto& instance : cavePlatform2_1Positions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CavePlatform2_1.Draw(Shaders);
-        }
-
-        for (const auto& instance : cavePlatform2_2Positions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CavePlatform2_2.Draw(Shaders);
-        }
-
-        for (const auto& instance : cavePlatform2_4Positions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            CavePlatform2_4.Draw(Shaders);
-        }
-
-        for (const auto& inst : cavePlatform2_2FloorPositions)
+        if (placementsMoved)
         {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, inst.position);
-            model = rotate(model, radians(inst.rotationY), vec3(0, 1, 0));
-            model = scale(model, inst.scale);
-
-            SetMatrices(Shaders);
-            CavePlatform2_2.Draw(Shaders);
+            RefitInstanceBvh(sceneBvh, sceneModels);
+            if (occlusion.enabled)
+                UpdateOcclusionItems(occlusion, sceneModels);
         }
 
-        for (const auto& inst : cavePlatform2_4FloorPositions)
+        visibleItems.clear();
+        QueryBvhFrustum(sceneBvh, ExtractFrustum(projection * view), visibleItems);
+
+        if (gpuScene.enabled)
         {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, inst.position);
-            model = rotate(model, radians(inst.rotationY), vec3(0, 1, 0));
-            model = scale(model, inst.scale);
-
-            SetMatrices(Shaders);
-            CavePlatform2_4.Draw(Shaders);
-        }
+            if (occlusion.enabled)
+                CullOcclusion(occlusion, gpuScene, visibleItems);
+            else
+                UpdateGpuSceneInstances(gpuScene, sceneModels, visibleItems, placementsMoved);
 
-        // Temple
-        for (const auto& instance : templePositions) {
-            model = mat4(1.0f);
-            model = translate(model, LEVEL_OFFSET);
-            model = translate(model, instance.position);
-            model = rotate(model, radians(instance.rotationY), vec3(0, 1, 0));
-            model = scale(model, instance.scale);
-            SetMatrices(Shaders);
-            TempleOfApollo.Draw(Shaders);
+            DrawGpuScene(gpuScene);
         }
+        else
+        {
+            UseShaderProgram(Shaders);
 
+            GroupBvhItems(visibleItems, visiblePlacements);
 
+            for (size_t i = 0; i < sceneModels.size(); i++)
+            {
+                SetVisibleInstances(sceneModels[i], visiblePlacements[i]);
+                QueueInstancedModel(renderQueue, sceneModels[i], Shaders);
+            }
 
+            SubmitRenderQueue(renderQueue);
+        }
 
+        // Swap buffers & poll events
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
 
+    CleanupTerrain(terrainCap);
+    CleanupTerrain(terrainBowl);
 
+    CleanupShaderProgram(Shaders);
+    CleanupShaderProgram(terrainShaders);
 
+    CleanupOcclusionCuller(occlusion);
+    CleanupCameraBuffer(cameraBuffer);
+    CleanupGpuScene(gpuScene);
 
+    for (InstancedModel& instanced : sceneModels)
+        CleanupInstancedModel(instanced);
 
-        // Swap buffers & poll events
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+    for (std::unique_ptr<ModelAsset>& model : models)
+        CleanupModelAsset(*model, textureCache);
+    CleanupTextureCache(textureCache);
 
     glfwTerminate();
     return 0;
@@ -881,13 +469,15 @@ void ProcessUserInput(GLFWwindow* WindowIn)
 }
 
 // -----------------------------------------------------------------------------
-// MVP UPLOAD
+// MODEL UPLOAD
 //
-// Must be called AFTER any change to model or view.
+// Must be called AFTER any change to model or view. Only the model matrix goes
+// to the program - the camera half is in the Camera block - but mvp is kept
+// current for the terrain's chunk culling.
 // -----------------------------------------------------------------------------
-void SetMatrices(Shader& ShaderProgramIn)
+void SetMatrices(const ShaderProgram& ShaderProgramIn, UniformHandle ModelIn)
 {
     mvp = projection * view * model;
-    ShaderProgramIn.setMat4("mvpIn", mvp);
+    SetUniform(ShaderProgramIn, ModelIn, model);
 }
 
@@ -0,0 +1,113 @@
+#include "assetfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool OpenAssetFile(const std::string& path, AssetFile& file)
+{
+    file = AssetFile();
+
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size))
+    {
+        CloseHandle(handle);
+        return false;
+    }
+
+    file.fileHandle = handle;
+    file.size = (size_t)size.QuadPart;
+
+    // A zero-length file cannot be mapped
+    if (file.size == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* view = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    file.mappingHandle = mapping;
+
+    if (view == NULL)
+    {
+        CloseAssetFile(file);
+        return false;
+    }
+
+    file.data = (const unsigned char*)view;
+    return true;
+}
+
+void CloseAssetFile(AssetFile& file)
+{
+    if (file.data != nullptr)
+        UnmapViewOfFile(file.data);
+    if (file.mappingHandle != nullptr)
+        CloseHandle((HANDLE)file.mappingHandle);
+    if (file.fileHandle != nullptr)
+        CloseHandle((HANDLE)file.fileHandle);
+
+    file = AssetFile();
+}
+
+#else
+
+bool OpenAssetFile(const std::string& path, AssetFile& file)
+{
+    file = AssetFile();
+
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0)
+    {
+        close(descriptor);
+        return false;
+    }
+
+    file.descriptor = descriptor;
+    file.size = (size_t)info.st_size;
+
+    // mmap rejects a zero length
+    if (file.size == 0)
+        return true;
+
+    void* view = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (view == MAP_FAILED)
+    {
+        CloseAssetFile(file);
+        return false;
+    }
+
+    // Every loader reads front to back
+    madvise(view, file.size, MADV_SEQUENTIAL);
+
+    file.data = (const unsigned char*)view;
+    return true;
+}
+
+void CloseAssetFile(AssetFile& file)
+{
+    if (file.data != nullptr)
+        munmap((void*)file.data, file.size);
+    if (file.descriptor >= 0)
+        close(file.descriptor);
+
+    file = AssetFile();
+}
+
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// -----------------------------------------------------------------------------
+// ASSET FILES
+//
+// Read-only, memory-mapped view of a whole file: mmap on Linux/macOS, a file
+// mapping on Windows. Loaders parse or hand the bytes straight on (GLSL
+// source to glShaderSource, images to stbi_load_from_memory, cooked meshes)
+// with no intermediate heap copy, and pages the loader never touches are
+// never read.
+//
+// The view is only valid until CloseAssetFile. Don't copy an open AssetFile -
+// both copies would unmap the same view.
+// -----------------------------------------------------------------------------
+struct AssetFile
+{
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int descriptor = -1;
+#endif
+};
+
+// False if the file is missing or cannot be mapped. An empty file opens with
+// data == nullptr and size == 0.
+bool OpenAssetFile(const std::string& path, AssetFile& file);
+
+void CloseAssetFile(AssetFile& file);
+
+// Sequential little-endian reads over a mapped file. Every read checks the
+// remaining size, so a truncated file fails cleanly instead of reading past
+// the end of the view.
+struct AssetReader
+{
+    const unsigned char* at = nullptr;
+    const unsigned char* end = nullptr;
+
+    explicit AssetReader(const AssetFile& file) : at(file.data), end(file.data + file.size) {}
+
+    size_t Remaining() const { return (size_t)(end - at); }
+
+    // Returns the next size bytes in place and steps over them, or nullptr
+    const unsigned char* Take(size_t size)
+    {
+        if (size > Remaining())
+            return nullptr;
+
+        const unsigned char* taken = at;
+        at += size;
+        return taken;
+    }
+
+    template <typename T>
+    bool Read(T& value)
+    {
+        const unsigned char* bytes = Take(sizeof(T));
+        if (bytes == nullptr)
+            return false;
+
+        std::memcpy(&value, bytes, sizeof(T));
+        return true;
+    }
+};
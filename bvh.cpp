@@ -0,0 +1,226 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+
+// Deep enough for a median-split tree over 2^60 leaves
+constexpr int BVH_STACK_SIZE = 64;
+
+static void GrowBounds(glm::vec3& boundsMin, glm::vec3& boundsMax, const glm::vec3& otherMin, const glm::vec3& otherMax)
+{
+    boundsMin = glm::min(boundsMin, otherMin);
+    boundsMax = glm::max(boundsMax, otherMax);
+}
+
+static bool SphereIntersectsAABB(const glm::vec3& centre, float radius, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    glm::vec3 closest = glm::clamp(centre, boxMin, boxMax);
+    glm::vec3 offset = centre - closest;
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+// Builds the subtree over items [first, last) and returns its node index
+static int BuildNode(InstanceBvh& bvh, int first, int last)
+{
+    int nodeIndex = (int)bvh.nodes.size();
+    bvh.nodes.push_back(BvhNode());
+
+    glm::vec3 boundsMin(FLT_MAX);
+    glm::vec3 boundsMax(-FLT_MAX);
+    glm::vec3 centreMin(FLT_MAX);
+    glm::vec3 centreMax(-FLT_MAX);
+
+    for (int i = first; i < last; i++)
+    {
+        const BvhItem& item = bvh.items[i];
+        glm::vec3 centre = (item.boundsMin + item.boundsMax) * 0.5f;
+
+        GrowBounds(boundsMin, boundsMax, item.boundsMin, item.boundsMax);
+        GrowBounds(centreMin, centreMax, centre, centre);
+    }
+
+    BvhNode& node = bvh.nodes[nodeIndex];
+    node.boundsMin = boundsMin;
+    node.boundsMax = boundsMax;
+    node.firstItem = first;
+    node.itemCount = last - first;
+
+    // Small enough, or every centre in one spot so no split would separate them
+    glm::vec3 spread = centreMax - centreMin;
+    if (node.itemCount <= BVH_LEAF_SIZE || glm::max(spread.x, glm::max(spread.y, spread.z)) <= 0.0f)
+        return nodeIndex;
+
+    int axis = 0;
+    if (spread.y > spread[axis]) axis = 1;
+    if (spread.z > spread[axis]) axis = 2;
+
+    // min + max orders items the same as their centres
+    int middle = first + node.itemCount / 2;
+    std::nth_element(bvh.items.begin() + first, bvh.items.begin() + middle, bvh.items.begin() + last,
+        [axis](const BvhItem& a, const BvhItem& b)
+        {
+            return a.boundsMin[axis] + a.boundsMax[axis] < b.boundsMin[axis] + b.boundsMax[axis];
+        });
+
+    BuildNode(bvh, first, middle);
+    int right = BuildNode(bvh, middle, last);
+
+    // node may have moved while the children were pushed
+    bvh.nodes[nodeIndex].rightChild = right;
+    return nodeIndex;
+}
+
+void BuildInstanceBvh(InstanceBvh& bvh, const std::vector<InstancedModel>& models)
+{
+    bvh.nodes.clear();
+    bvh.items.clear();
+
+    for (int model = 0; model < (int)models.size(); model++)
+    {
+        for (int placement = 0; placement < (int)models[model].placements.size(); placement++)
+        {
+            const InstanceTransform& instance = *models[model].placements[placement];
+
+            BvhItem item;
+            item.model = model;
+            item.placement = placement;
+            item.boundsMin = instance.boundsMin;
+            item.boundsMax = instance.boundsMax;
+            bvh.items.push_back(item);
+        }
+    }
+
+    if (bvh.items.empty())
+        return;
+
+    // Median splits leave at least BVH_LEAF_SIZE / 2 items per leaf
+    bvh.nodes.reserve(4 * bvh.items.size() / BVH_LEAF_SIZE + 1);
+    BuildNode(bvh, 0, (int)bvh.items.size());
+}
+
+void RefitInstanceBvh(InstanceBvh& bvh, const std::vector<InstancedModel>& models)
+{
+    for (BvhItem& item : bvh.items)
+    {
+        const InstanceTransform& instance = *models[item.model].placements[item.placement];
+        item.boundsMin = instance.boundsMin;
+        item.boundsMax = instance.boundsMax;
+    }
+
+    // Children always come after their parent, so walking backwards finishes
+    // both children before the parent reads them
+    for (int i = (int)bvh.nodes.size() - 1; i >= 0; i--)
+    {
+        BvhNode& node = bvh.nodes[i];
+
+        if (node.rightChild < 0)
+        {
+            node.boundsMin = glm::vec3(FLT_MAX);
+            node.boundsMax = glm::vec3(-FLT_MAX);
+
+            for (int item = node.firstItem; item < node.firstItem + node.itemCount; item++)
+                GrowBounds(node.boundsMin, node.boundsMax, bvh.items[item].boundsMin, bvh.items[item].boundsMax);
+        }
+        else
+        {
+            const BvhNode& left = bvh.nodes[i + 1];
+            const BvhNode& right = bvh.nodes[node.rightChild];
+
+            node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+            node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+        }
+    }
+}
+
+void QueryBvhFrustum(InstanceBvh& bvh, const Frustum& frustum, std::vector<BvhItem>& visible)
+{
+    bvh.nodesVisited = 0;
+    if (bvh.nodes.empty())
+        return;
+
+    int stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        int nodeIndex = stack[--top];
+        const BvhNode& node = bvh.nodes[nodeIndex];
+        bvh.nodesVisited++;
+
+        FrustumTest test = ClassifyAABB(frustum, node.boundsMin, node.boundsMax);
+        if (test == FrustumTest::Outside)
+            continue;
+
+        if (test == FrustumTest::Inside)
+        {
+            visible.insert(visible.end(), bvh.items.begin() + node.firstItem,
+                bvh.items.begin() + node.firstItem + node.itemCount);
+            continue;
+        }
+
+        if (node.rightChild >= 0)
+        {
+            stack[top++] = node.rightChild;
+            stack[top++] = nodeIndex + 1;
+            continue;
+        }
+
+        for (int item = node.firstItem; item < node.firstItem + node.itemCount; item++)
+        {
+            if (FrustumIntersectsAABB(frustum, bvh.items[item].boundsMin, bvh.items[item].boundsMax))
+                visible.push_back(bvh.items[item]);
+        }
+    }
+}
+
+void QueryBvhSphere(InstanceBvh& bvh, const glm::vec3& centre, float radius, std::vector<BvhItem>& found)
+{
+    bvh.nodesVisited = 0;
+    if (bvh.nodes.empty())
+        return;
+
+    int stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        int nodeIndex = stack[--top];
+        const BvhNode& node = bvh.nodes[nodeIndex];
+        bvh.nodesVisited++;
+
+        if (!SphereIntersectsAABB(centre, radius, node.boundsMin, node.boundsMax))
+            continue;
+
+        if (node.rightChild >= 0)
+        {
+            stack[top++] = node.rightChild;
+            stack[top++] = nodeIndex + 1;
+            continue;
+        }
+
+        for (int item = node.firstItem; item < node.firstItem + node.itemCount; item++)
+        {
+            if (SphereIntersectsAABB(centre, radius, bvh.items[item].boundsMin, bvh.items[item].boundsMax))
+                found.push_back(bvh.items[item]);
+        }
+    }
+}
+
+void GroupBvhItems(const std::vector<BvhItem>& items, std::vector<std::vector<int>>& perModel)
+{
+    for (std::vector<int>& placements : perModel)
+        placements.clear();
+
+    for (const BvhItem& item : items)
+    {
+        if (item.model >= (int)perModel.size())
+            perModel.resize(item.model + 1);
+
+        perModel[item.model].push_back(item.placement);
+    }
+
+    for (std::vector<int>& placements : perModel)
+        std::sort(placements.begin(), placements.end());
+}
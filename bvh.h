@@ -0,0 +1,68 @@
+#pragma once
+
+#include "frustum.h"
+#include "instancing.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// INSTANCE BVH
+//
+// Bounding volume hierarchy over the world space AABBs of every placement of
+// every InstancedModel. Built top-down by splitting each node's items at the
+// median centroid along its longest axis, so the tree stays balanced and a
+// query only walks the branches that reach the region it asks about.
+//
+// Nodes are stored depth-first: a node's left child follows it directly and
+// its right child sits at rightChild. Leaves hold up to BVH_LEAF_SIZE items.
+// Items keep their own copy of each placement's bounds, so queries never
+// touch the models.
+// -----------------------------------------------------------------------------
+constexpr int BVH_LEAF_SIZE = 4;
+
+// One placement: which InstancedModel, which of its placements, and a copy
+// of its world bounds taken at build / refit time
+struct BvhItem
+{
+    int model;
+    int placement;
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+
+struct BvhNode
+{
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+
+    int rightChild = -1;   // -1 for a leaf
+    int firstItem = 0;     // the subtree's items are one run of InstanceBvh::items
+    int itemCount = 0;
+};
+
+struct InstanceBvh
+{
+    std::vector<BvhNode> nodes;
+    std::vector<BvhItem> items;
+
+    int nodesVisited = 0;  // by the last query, for checking culling cost
+};
+
+// Builds over the current bounds of every placement - refresh the models first
+void BuildInstanceBvh(InstanceBvh& bvh, const std::vector<InstancedModel>& models);
+
+// Re-reads every item's bounds and grows the nodes to fit, keeping the tree
+// shape. Cheap enough per frame; rebuild instead after large moves.
+void RefitInstanceBvh(InstanceBvh& bvh, const std::vector<InstancedModel>& models);
+
+// Append the items whose bounds touch the frustum / sphere.
+// Subtrees wholly inside the frustum are taken without testing their items.
+void QueryBvhFrustum(InstanceBvh& bvh, const Frustum& frustum, std::vector<BvhItem>& visible);
+void QueryBvhSphere(InstanceBvh& bvh, const glm::vec3& centre, float radius, std::vector<BvhItem>& found);
+
+// Splits query results into one sorted placement list per model, ready for
+// SetVisibleInstances
+void GroupBvhItems(const std::vector<BvhItem>& items, std::vector<std::vector<int>>& perModel);
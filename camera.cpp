@@ -0,0 +1,32 @@
+#include "camera.h"
+
+void InitialiseCameraBuffer(CameraBuffer& camera)
+{
+    glGenBuffers(1, &camera.UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, camera.UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UBO_BINDING, camera.UBO);
+}
+
+void UpdateCameraBuffer(CameraBuffer& camera, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position)
+{
+    camera.block.view = view;
+    camera.block.projection = projection;
+    camera.block.viewProjection = projection * view;
+    camera.block.position = glm::vec4(position, 1.0f);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, camera.UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &camera.block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Cheap, and survives anything else having borrowed the binding point
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UBO_BINDING, camera.UBO);
+}
+
+void CleanupCameraBuffer(CameraBuffer& camera)
+{
+    glDeleteBuffers(1, &camera.UBO);
+    camera.UBO = 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// -----------------------------------------------------------------------------
+// PER-FRAME CAMERA BLOCK
+//
+// View and projection go up once a frame into one uniform buffer bound at
+// CAMERA_UBO_BINDING. Every program declares the matching Camera block with
+// layout(binding = 0), so no program needs a matrix set on it per draw, and
+// a program switch costs nothing camera-wise.
+//
+// Per-object transforms stay where they were: instance attributes for the
+// scene, a model uniform for the terrain.
+// -----------------------------------------------------------------------------
+constexpr GLuint CAMERA_UBO_BINDING = 0;
+
+// std140 - mirrored by the Camera block in the shaders. mat4 and vec4 have
+// no padding rules to trip over, so the C++ layout matches as written.
+struct CameraBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 position;       // world space, w = 1
+};
+
+struct CameraBuffer
+{
+    GLuint UBO = 0;
+    CameraBlock block;
+};
+
+void InitialiseCameraBuffer(CameraBuffer& camera);
+
+// Fills the block, uploads it and (re)binds it to CAMERA_UBO_BINDING
+void UpdateCameraBuffer(CameraBuffer& camera, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position);
+
+void CleanupCameraBuffer(CameraBuffer& camera);
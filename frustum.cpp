@@ -0,0 +1,74 @@
+#include "frustum.h"
+
+Frustum ExtractFrustum(const glm::mat4& clip)
+{
+    // glm is column-major, so row i is (clip[0][i], clip[1][i], clip[2][i], clip[3][i])
+    glm::vec4 row0(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+    glm::vec4 row1(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+    glm::vec4 row2(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+    glm::vec4 row3(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0; // left
+    frustum.planes[1] = row3 - row0; // right
+    frustum.planes[2] = row3 + row1; // bottom
+    frustum.planes[3] = row3 - row1; // top
+    frustum.planes[4] = row3 + row2; // near
+    frustum.planes[5] = row3 - row2; // far
+
+    for (glm::vec4& plane : frustum.planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+bool FrustumIntersectsAABB(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    for (const glm::vec4& plane : frustum.planes)
+    {
+        // Corner furthest along the plane normal - if that one is outside, the whole box is
+        glm::vec3 positive(
+            plane.x >= 0.0f ? boxMax.x : boxMin.x,
+            plane.y >= 0.0f ? boxMax.y : boxMin.y,
+            plane.z >= 0.0f ? boxMax.z : boxMin.z
+        );
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+FrustumTest ClassifyAABB(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    FrustumTest result = FrustumTest::Inside;
+
+    for (const glm::vec4& plane : frustum.planes)
+    {
+        glm::vec3 normal(plane);
+
+        glm::vec3 positive(
+            plane.x >= 0.0f ? boxMax.x : boxMin.x,
+            plane.y >= 0.0f ? boxMax.y : boxMin.y,
+            plane.z >= 0.0f ? boxMax.z : boxMin.z
+        );
+
+        if (glm::dot(normal, positive) + plane.w < 0.0f)
+            return FrustumTest::Outside;
+
+        // Nearest corner - if that one is outside, the plane cuts the box
+        glm::vec3 negative(
+            plane.x >= 0.0f ? boxMin.x : boxMax.x,
+            plane.y >= 0.0f ? boxMin.y : boxMax.y,
+            plane.z >= 0.0f ? boxMin.z : boxMax.z
+        );
+
+        if (glm::dot(normal, negative) + plane.w < 0.0f)
+            result = FrustumTest::Intersects;
+    }
+
+    return result;
+}
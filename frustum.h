@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// -----------------------------------------------------------------------------
+// VIEW FRUSTUM
+//
+// Six planes (ax + by + cz + d = 0) pulled straight out of a clip matrix.
+// Normals point inwards, so a point is inside when every plane gives >= 0.
+//
+// Planes come out in whatever space the matrix starts from:
+//   projection * view          -> world space
+//   projection * view * model  -> that model's local space
+// -----------------------------------------------------------------------------
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+Frustum ExtractFrustum(const glm::mat4& clip);
+
+// True if the box is at least partly inside the frustum
+bool FrustumIntersectsAABB(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+enum class FrustumTest
+{
+    Outside,
+    Intersects,
+    Inside      // every corner inside every plane
+};
+
+// Like FrustumIntersectsAABB, but also says when the box is wholly inside,
+// so hierarchies can accept a whole subtree without testing further
+FrustumTest ClassifyAABB(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax);
@@ -0,0 +1,437 @@
+#include "gpuscene.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+static GLuint CreateBuffer(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    glBufferData(target, std::max<GLsizeiptr>(size, 4), data, usage);
+    glBindBuffer(target, 0);
+    return buffer;
+}
+
+static int TextureLevels(int width, int height)
+{
+    int size = std::max(width, height);
+    int levels = 1;
+    while ((size >> levels) > 0)
+        levels++;
+    return levels;
+}
+
+// Sampling parameters shared by every group's array
+static void SetArrayParameters()
+{
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// Block-compressed textures keep their blocks: every mip level of every
+// texture is copied straight into its layer, so the array is the same size
+// in memory as its sources and needs no glGenerateMipmap
+static void CopyCompressedArray(GpuSceneTextureGroup& group, const std::vector<GLuint>& textures)
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, group.textureArray);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, group.levels, group.format, group.width, group.height, (GLsizei)textures.size());
+
+    for (size_t layer = 0; layer < textures.size(); layer++)
+    {
+        for (int level = 0; level < group.levels; level++)
+        {
+            glCopyImageSubData(textures[layer], GL_TEXTURE_2D, level, 0, 0, 0,
+                group.textureArray, GL_TEXTURE_2D_ARRAY, level, 0, 0, (GLint)layer,
+                std::max(group.width >> level, 1), std::max(group.height >> level, 1), 1);
+        }
+    }
+
+    SetArrayParameters();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+// Uncompressed textures - the fallback without S3TC - may each have their own
+// channel count, so they are drawn into RGBA8 layers at their own size
+// (textureResample.vert/.frag) and the array is mipmapped afterwards. Texture
+// 0 stands for plain white, for meshes without a diffuse texture.
+static void ResampleArray(GpuSceneTextureGroup& group, const std::vector<GLuint>& textures, const ShaderProgram& resample,
+    bool canResample, GLuint framebuffer, GLuint emptyVAO)
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, group.textureArray);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, group.levels, group.format, group.width, group.height, (GLsizei)textures.size());
+
+    std::vector<GLubyte> white;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindVertexArray(emptyVAO);
+    glViewport(0, 0, group.width, group.height);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (size_t layer = 0; layer < textures.size(); layer++)
+    {
+        if (textures[layer] == 0 || !canResample)
+        {
+            white.assign(group.width * group.height * 4, 255);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, group.textureArray);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)layer, group.width, group.height, 1,
+                GL_RGBA, GL_UNSIGNED_BYTE, white.data());
+            continue;
+        }
+
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, group.textureArray, 0, (GLint)layer);
+        glBindTexture(GL_TEXTURE_2D, textures[layer]);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, group.textureArray);
+    if (group.levels > 1)
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    SetArrayParameters();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+// One texture array per distinct size and format, so every texture keeps its
+// own resolution, aspect ratio and compression
+static void BuildTextureArrays(std::vector<GpuSceneTextureGroup>& groups, const std::vector<std::vector<GLuint>>& groupTextures)
+{
+    // Only uncompressed textures are drawn, and the white layer needs no shader
+    bool drawsTextures = false;
+    for (size_t g = 0; g < groups.size(); g++)
+    {
+        for (GLuint texture : groupTextures[g])
+            drawsTextures = drawsTextures || (!groups[g].compressed && texture != 0);
+    }
+
+    ShaderProgram resample;
+    bool canResample = false;
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLuint framebuffer = 0;
+    GLuint emptyVAO = 0;
+
+    if (drawsTextures)
+    {
+        canResample = LoadShaderProgram(resample, "shaders/textureResample.vert", "shaders/textureResample.frag");
+        if (!canResample)
+            std::cout << "Texture resample shaders failed to build - uncompressed scene textures are left white\n";
+
+        UseShaderProgram(resample);
+        SetUniform(resample, FindUniform(resample, "source"), 0);
+
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+
+        // The triangle needs no attributes, but core profile still wants a VAO
+        glGenFramebuffers(1, &framebuffer);
+        glGenVertexArrays(1, &emptyVAO);
+    }
+
+    for (size_t g = 0; g < groups.size(); g++)
+    {
+        glGenTextures(1, &groups[g].textureArray);
+
+        if (groups[g].compressed)
+            CopyCompressedArray(groups[g], groupTextures[g]);
+        else
+            ResampleArray(groups[g], groupTextures[g], resample, canResample, framebuffer, emptyVAO);
+    }
+
+    if (drawsTextures)
+    {
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteFramebuffers(1, &framebuffer);
+        glUseProgram(0);
+        CleanupShaderProgram(resample);
+
+        if (depthTest) glEnable(GL_DEPTH_TEST);
+        if (cullFace)  glEnable(GL_CULL_FACE);
+        if (blend)     glEnable(GL_BLEND);
+    }
+
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+bool InitialiseGpuScene(GpuScene& scene, const std::vector<InstancedModel>& models)
+{
+    scene = GpuScene();
+
+    if (!GLAD_GL_VERSION_4_3)
+    {
+        std::cout << "Multi-draw indirect needs OpenGL 4.3 - drawing models one mesh at a time\n";
+        return false;
+    }
+
+    ShaderInfo shaders[] = {
+        { GL_VERTEX_SHADER, "shaders/sceneIndirect.vert", 0 },
+        { GL_FRAGMENT_SHADER, "shaders/sceneIndirect.frag", 0 },
+        { GL_NONE, NULL, 0 }
+    };
+
+    if (!LoadShaderProgram(scene.program, shaders))
+    {
+        std::cout << "Scene indirect shaders failed to build - drawing models one mesh at a time\n";
+        return false;
+    }
+
+    // Merge geometry, one command per mesh
+    std::vector<GpuSceneVertex> vertices;
+    std::vector<GLuint> indices;
+    std::vector<DrawElementsIndirectCommand> meshCommands;
+    std::vector<GLuint> meshModels;
+    std::vector<GLuint> meshTextures;    // first diffuse texture of each mesh, 0 for none
+
+    for (int model = 0; model < (int)models.size(); model++)
+    {
+        scene.modelBase.push_back(scene.itemCount);
+
+        for (const Mesh& mesh : models[model].model->meshes)
+        {
+            DrawElementsIndirectCommand command;
+            command.count = (GLuint)mesh.indices.size();
+            command.instanceCount = 0;
+            command.firstIndex = (GLuint)indices.size();
+            command.baseVertex = (GLint)vertices.size();
+            command.baseInstance = (GLuint)scene.itemCount;
+            meshCommands.push_back(command);
+            meshModels.push_back((GLuint)model);
+
+            for (const Vertex& vertex : mesh.vertices)
+                vertices.push_back({ vertex.Position, vertex.TexCoords });
+            indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+            // First diffuse texture, as fragmentShader.frag only samples texture_diffuse1
+            GLuint diffuse = 0;
+            for (const Texture& texture : mesh.textures)
+            {
+                if (texture.type == "texture_diffuse")
+                {
+                    diffuse = texture.id;
+                    break;
+                }
+            }
+            meshTextures.push_back(diffuse);
+        }
+
+        scene.itemCount += (int)models[model].placements.size();
+    }
+
+    // Group the distinct textures by size and format - white is a single
+    // uncompressed texel - and give each a layer in its group's array
+    std::map<std::tuple<int, int, GLenum, int>, int> groupOfFormat;
+    std::map<GLuint, std::pair<int, GLuint>> textureSlots;    // texture -> group, layer
+    std::vector<std::vector<GLuint>> groupTextures;
+
+    for (GLuint texture : meshTextures)
+    {
+        if (textureSlots.count(texture))
+            continue;
+
+        GpuSceneTextureGroup group;
+        group.width = 1;
+        group.height = 1;
+        group.format = GL_RGBA8;
+
+        if (texture != 0)
+        {
+            GLint compressed = GL_FALSE;
+            GLint internalFormat = GL_NONE;
+            GLint maxLevel = 0;
+
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &group.width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &group.height);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+            glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            // The texture cache uploads compressed textures with their whole
+            // chain and sets GL_TEXTURE_MAX_LEVEL to its last level
+            if (compressed == GL_TRUE)
+            {
+                group.compressed = true;
+                group.format = (GLenum)internalFormat;
+                group.levels = std::min(maxLevel + 1, TextureLevels(group.width, group.height));
+            }
+        }
+
+        if (!group.compressed)
+            group.levels = TextureLevels(group.width, group.height);
+
+        auto key = std::make_tuple(group.width, group.height, group.format, group.levels);
+        auto found = groupOfFormat.find(key);
+        if (found == groupOfFormat.end())
+        {
+            scene.textureGroups.push_back(group);
+            groupTextures.emplace_back();
+            found = groupOfFormat.emplace(key, (int)scene.textureGroups.size() - 1).first;
+        }
+
+        std::vector<GLuint>& layers = groupTextures[found->second];
+        textureSlots[texture] = { found->second, (GLuint)layers.size() };
+        layers.push_back(texture);
+    }
+
+    // Commands sorted by group, so each group is one contiguous multi-draw
+    std::vector<GLuint> drawLayers;
+    for (int group = 0; group < (int)scene.textureGroups.size(); group++)
+    {
+        scene.textureGroups[group].firstCommand = (GLint)scene.commands.size();
+
+        for (size_t mesh = 0; mesh < meshCommands.size(); mesh++)
+        {
+            const std::pair<int, GLuint>& slot = textureSlots[meshTextures[mesh]];
+            if (slot.first != group)
+                continue;
+
+            scene.commands.push_back(meshCommands[mesh]);
+            scene.commandModels.push_back(meshModels[mesh]);
+            drawLayers.push_back(slot.second);
+        }
+
+        scene.textureGroups[group].commandCount = (GLsizei)scene.commands.size() - scene.textureGroups[group].firstCommand;
+    }
+
+    glGenVertexArrays(1, &scene.VAO);
+    glBindVertexArray(scene.VAO);
+
+    scene.VBO = CreateBuffer(GL_ARRAY_BUFFER, vertices.size() * sizeof(GpuSceneVertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, scene.VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GpuSceneVertex), (void*)offsetof(GpuSceneVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(GpuSceneVertex), (void*)offsetof(GpuSceneVertex, texCoords));
+    glEnableVertexAttribArray(2);
+
+    // Same per-instance matrix layout as instancing.h
+    scene.instanceBuffer = CreateBuffer(GL_ARRAY_BUFFER, scene.itemCount * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, scene.instanceBuffer);
+    for (GLuint column = 0; column < 4; column++)
+    {
+        GLuint location = INSTANCE_MATRIX_LOCATION + column;
+
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+
+    // The element buffer binding is VAO state, so bind it while the VAO is
+    glGenBuffers(1, &scene.EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, scene.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    scene.commandBuffer = CreateBuffer(GL_DRAW_INDIRECT_BUFFER, scene.commands.size() * sizeof(DrawElementsIndirectCommand),
+        scene.commands.data(), GL_DYNAMIC_DRAW);
+    scene.commandModelBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, scene.commandModels.size() * sizeof(GLuint),
+        scene.commandModels.data(), GL_STATIC_DRAW);
+    scene.drawDataBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, drawLayers.size() * sizeof(GLuint),
+        drawLayers.data(), GL_STATIC_DRAW);
+
+    BuildTextureArrays(scene.textureGroups, groupTextures);
+
+    // Each array sits on unit 0 in turn, so the sampler is set once
+    UseShaderProgram(scene.program);
+    SetUniform(scene.program, FindUniform(scene.program, "sceneTextures"), 0);
+    scene.drawBase = FindUniform(scene.program, "drawBase");
+    glUseProgram(0);
+
+    std::cout << "GPU scene: " << scene.commands.size() << " meshes, " << vertices.size() << " vertices, "
+        << textureSlots.size() << " textures in " << scene.textureGroups.size() << " draws (one per texture size and format)\n";
+
+    scene.enabled = true;
+    return true;
+}
+
+void UpdateGpuSceneInstances(GpuScene& scene, const std::vector<InstancedModel>& models,
+    const std::vector<BvhItem>& visible, bool placementsMoved)
+{
+    std::vector<GLuint> slots;
+    slots.reserve(visible.size());
+    for (const BvhItem& item : visible)
+        slots.push_back((GLuint)(scene.modelBase[item.model] + item.placement));
+
+    std::sort(slots.begin(), slots.end());
+    if (!placementsMoved && slots == scene.lastVisible)
+        return;
+
+    scene.lastVisible = slots;
+
+    // Visible matrices packed at the front of each model's range
+    std::vector<glm::mat4> matrices(scene.itemCount);
+    std::vector<GLuint> counts(models.size(), 0);
+
+    for (const BvhItem& item : visible)
+    {
+        matrices[scene.modelBase[item.model] + counts[item.model]] = models[item.model].placements[item.placement]->world;
+        counts[item.model]++;
+    }
+
+    for (size_t command = 0; command < scene.commands.size(); command++)
+        scene.commands[command].instanceCount = counts[scene.commandModels[command]];
+
+    glBindBuffer(GL_ARRAY_BUFFER, scene.instanceBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, matrices.size() * sizeof(glm::mat4), matrices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, scene.commandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, scene.commands.size() * sizeof(DrawElementsIndirectCommand), scene.commands.data());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void DrawGpuScene(const GpuScene& scene)
+{
+    if (!scene.enabled || scene.commands.empty())
+        return;
+
+    UseShaderProgram(scene.program);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_SCENE_DRAW_DATA_BINDING, scene.drawDataBuffer);
+
+    glBindVertexArray(scene.VAO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, scene.commandBuffer);
+
+    // gl_DrawID restarts at 0 for each call, so drawBase says where it starts
+    for (const GpuSceneTextureGroup& group : scene.textureGroups)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, group.textureArray);
+        SetUniform(scene.program, scene.drawBase, (GLuint)group.firstCommand);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+            (void*)(group.firstCommand * sizeof(DrawElementsIndirectCommand)), group.commandCount, 0);
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void CleanupGpuScene(GpuScene& scene)
+{
+    GLuint buffers[] = {
+        scene.VBO, scene.EBO, scene.instanceBuffer, scene.commandBuffer, scene.commandModelBuffer, scene.drawDataBuffer
+    };
+    glDeleteBuffers(sizeof(buffers) / sizeof(buffers[0]), buffers);
+    glDeleteVertexArrays(1, &scene.VAO);
+    for (const GpuSceneTextureGroup& group : scene.textureGroups)
+        glDeleteTextures(1, &group.textureArray);
+    CleanupShaderProgram(scene.program);
+
+    scene = GpuScene();
+}
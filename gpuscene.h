@@ -0,0 +1,101 @@
+#pragma once
+
+#include "bvh.h"
+#include "instancing.h"
+#include "shaderprogram.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// GPU-DRIVEN SCENE
+//
+// Every mesh of every scene model merged into one vertex buffer and one index
+// buffer behind a single VAO, with one DrawElementsIndirectCommand per mesh.
+// The whole scene is then one glMultiDrawElementsIndirect per distinct texture
+// size and format, however many models and meshes it has.
+//
+// What differs per mesh comes from gl_DrawID:
+//   - the diffuse texture is a layer of the texture array for its size and
+//     format, so each texture keeps its own resolution, aspect ratio and
+//     block compression (the blocks and mips are copied, not re-encoded);
+//     the commands are sorted by array, one contiguous range per draw call
+//   - the layer index is read from an SSBO of per-draw data
+//
+// Placements are one shared matrix buffer with a range per model; each
+// command's baseInstance points at its model's range and instanceCount says
+// how much of it is in use. Either the CPU (UpdateGpuSceneInstances, from the
+// BVH result) or the occlusion pass (occlusion.h) fills both in.
+// -----------------------------------------------------------------------------
+constexpr GLuint GPU_SCENE_DRAW_DATA_BINDING = 7;    // sceneIndirect.vert
+
+// Layout fixed by the glDrawElementsIndirect spec - also mirrored in occlusionCull.comp
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Only what the scene shaders read: 20 bytes instead of learnopengl's Vertex
+struct GpuSceneVertex
+{
+    glm::vec3 position;
+    glm::vec2 texCoords;
+};
+
+// The meshes whose diffuse textures share one size and format
+struct GpuSceneTextureGroup
+{
+    int width = 0;
+    int height = 0;
+    GLenum format = GL_RGBA8;         // the textures' own, if compressed
+    int levels = 1;
+    bool compressed = false;
+    GLuint textureArray = 0;
+    GLint firstCommand = 0;           // this group's range of commands
+    GLsizei commandCount = 0;
+};
+
+struct GpuScene
+{
+    bool enabled = false;
+
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLuint EBO = 0;
+    GLuint instanceBuffer = 0;        // world matrices, modelBase[m] onwards per model
+    GLuint commandBuffer = 0;         // DrawElementsIndirectCommand per mesh
+    GLuint commandModelBuffer = 0;    // model of each command
+    GLuint drawDataBuffer = 0;        // texture layer of each command
+    std::vector<GpuSceneTextureGroup> textureGroups;
+    ShaderProgram program;            // sceneIndirect.vert/.frag
+    UniformHandle drawBase = UNIFORM_NONE;
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<GLuint> commandModels; // model of each command
+    std::vector<int> modelBase;       // per model, first slot in instanceBuffer
+    int itemCount = 0;                // placements across all models
+
+    std::vector<GLuint> lastVisible;  // CPU path: skip the upload when unchanged
+};
+
+// Merges the models' meshes and textures. Returns false if the context is
+// older than 4.3 or the shaders fail - the per-model path still works then.
+bool InitialiseGpuScene(GpuScene& scene, const std::vector<InstancedModel>& models);
+
+// CPU visibility: writes the matrices of these placements into each model's
+// range and the counts into the commands. Nothing is uploaded if the list is
+// the same as last frame and no placement was refreshed.
+void UpdateGpuSceneInstances(GpuScene& scene, const std::vector<InstancedModel>& models,
+    const std::vector<BvhItem>& visible, bool placementsMoved);
+
+// One draw call per texture size and format, with the camera from the Camera
+// block (camera.h). Leaves the program and texture bindings changed.
+void DrawGpuScene(const GpuScene& scene);
+
+void CleanupGpuScene(GpuScene& scene);
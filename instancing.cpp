@@ -0,0 +1,154 @@
+#include "instancing.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cfloat>
+
+void ComputeModelBounds(const ModelAsset& model, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    // Recorded per mesh at import (or read from the mesh cache)
+    boundsMin = model.boundsMin;
+    boundsMax = model.boundsMax;
+
+    if (boundsMin.x > boundsMax.x)
+        boundsMin = boundsMax = glm::vec3(0.0f);
+}
+
+// -----------------------------------------------------------------------------
+// MODEL TRANSFORM REFERENCE
+//
+// Standard per-object transform order:
+//
+// world = parent;                          // Level anchor point
+// world = translate(world, position);      // Place object in world
+// world = rotate(world, angle, axis);      // Optional rotation
+// world = scale(world, instance.scale);    // Uniform/non-uniform scale
+// -----------------------------------------------------------------------------
+bool UpdateInstanceTransform(InstanceTransform& instance, const glm::mat4& parent,
+    const glm::vec3& localMin, const glm::vec3& localMax)
+{
+    if (!instance.dirty)
+        return false;
+
+    glm::mat4 world = parent;
+    world = glm::translate(world, instance.position);
+    world = glm::rotate(world, glm::radians(instance.rotationY), glm::vec3(0, 1, 0));
+    world = glm::scale(world, instance.scale);
+    instance.world = world;
+
+    // Transformed box: centre moves with the matrix, each world axis gets
+    // |m| times the local half extents
+    glm::vec3 centre = (localMin + localMax) * 0.5f;
+    glm::vec3 extent = (localMax - localMin) * 0.5f;
+
+    glm::vec3 worldCentre = glm::vec3(world * glm::vec4(centre, 1.0f));
+    glm::vec3 worldExtent = glm::abs(glm::vec3(world[0])) * extent.x
+        + glm::abs(glm::vec3(world[1])) * extent.y
+        + glm::abs(glm::vec3(world[2])) * extent.z;
+
+    instance.boundsMin = worldCentre - worldExtent;
+    instance.boundsMax = worldCentre + worldExtent;
+    instance.dirty = false;
+
+    return true;
+}
+
+// Replaces every matrix in the buffer - the count can change
+static void UploadInstances(InstancedModel& instanced)
+{
+    std::vector<glm::mat4> worldMatrices;
+    worldMatrices.reserve(instanced.placements.size());
+    for (const InstanceTransform* instance : instanced.placements)
+        worldMatrices.push_back(instance->world);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanced.matrixVBO);
+    glBufferData(GL_ARRAY_BUFFER, worldMatrices.size() * sizeof(glm::mat4), worldMatrices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    instanced.instanceCount = (GLsizei)worldMatrices.size();
+    instanced.visibleOnly = false;
+}
+
+void InitialiseInstancedModel(InstancedModel& instanced, ModelAsset& model, const glm::mat4& parent,
+    const std::vector<InstanceTransform*>& placements)
+{
+    instanced.model = &model;
+    instanced.parent = parent;
+    instanced.placements = placements;
+    ComputeModelBounds(model, instanced.localMin, instanced.localMax);
+
+    for (InstanceTransform* instance : instanced.placements)
+    {
+        instance->dirty = true;
+        UpdateInstanceTransform(*instance, parent, instanced.localMin, instanced.localMax);
+    }
+
+    glGenBuffers(1, &instanced.matrixVBO);
+    UploadInstances(instanced);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanced.matrixVBO);
+
+    for (Mesh& mesh : model.meshes)
+    {
+        glBindVertexArray(mesh.VAO);
+
+        // A mat4 attribute is four vec4 columns in consecutive locations
+        for (GLuint column = 0; column < 4; column++)
+        {
+            GLuint location = INSTANCE_MATRIX_LOCATION + column;
+
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                (void*)(column * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool RefreshInstances(InstancedModel& instanced)
+{
+    bool changed = false;
+    for (InstanceTransform* instance : instanced.placements)
+        changed |= UpdateInstanceTransform(*instance, instanced.parent, instanced.localMin, instanced.localMax);
+
+    if (changed)
+        UploadInstances(instanced);
+
+    return changed;
+}
+
+void SetVisibleInstances(InstancedModel& instanced, const std::vector<int>& visible)
+{
+    if (instanced.visibleOnly && visible == instanced.visible)
+        return;
+
+    instanced.visible = visible;
+    instanced.visibleOnly = true;
+    instanced.instanceCount = (GLsizei)visible.size();
+
+    if (visible.empty())
+        return;
+
+    std::vector<glm::mat4> worldMatrices;
+    worldMatrices.reserve(visible.size());
+    for (int placement : visible)
+        worldMatrices.push_back(instanced.placements[placement]->world);
+
+    // The buffer was sized for every placement, so any subset fits
+    glBindBuffer(GL_ARRAY_BUFFER, instanced.matrixVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, worldMatrices.size() * sizeof(glm::mat4), worldMatrices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void CleanupInstancedModel(InstancedModel& instanced)
+{
+    glDeleteBuffers(1, &instanced.matrixVBO);
+
+    instanced.matrixVBO = 0;
+    instanced.instanceCount = 0;
+    instanced.model = nullptr;
+    instanced.placements.clear();
+}
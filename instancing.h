@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/model.h>
+
+#include "modelloader.h"
+#include "shaderprogram.h"
+
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// INSTANCED MODELS
+//
+// Every placement of a model lives in one buffer of world matrices, attached
+// to each of the model's mesh VAOs as a per-instance attribute. Drawing the
+// model is then one glDrawElementsInstanced per mesh, however many times it
+// is placed - the render queue (renderqueue.h) issues them.
+//
+// The matrix takes attribute locations 7-10, after the learnopengl Vertex
+// layout (0-6). A VAO holds one instance buffer, so a model can only belong
+// to one InstancedModel - merge its placement lists instead.
+// -----------------------------------------------------------------------------
+constexpr GLuint INSTANCE_MATRIX_LOCATION = 7;
+
+// One placement of a model. world and the bounds are built from the first
+// three fields by UpdateInstanceTransform and are only rebuilt while dirty -
+// set dirty after editing position, rotationY or scale.
+struct InstanceTransform
+{
+    glm::vec3 position;     // OpenGL world position
+    float rotationY;        // Y-axis rotation in degrees (Blender Z)
+    glm::vec3 scale;        // Usually uniform
+
+    glm::mat4 world = glm::mat4(1.0f);
+    glm::vec3 boundsMin = glm::vec3(0.0f);     // world space AABB
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    bool dirty = true;
+};
+
+struct InstancedModel
+{
+    ModelAsset* model = nullptr;
+    GLuint matrixVBO = 0;
+    GLsizei instanceCount = 0;
+
+    glm::mat4 parent = glm::mat4(1.0f);        // applied before every placement
+    glm::vec3 localMin = glm::vec3(0.0f);      // model space AABB of all meshes
+    glm::vec3 localMax = glm::vec3(0.0f);
+    std::vector<InstanceTransform*> placements;
+
+    // Placements currently in the buffer when culled by SetVisibleInstances
+    std::vector<int> visible;
+    bool visibleOnly = false;
+};
+
+// AABB of every vertex of every mesh, in model space
+void ComputeModelBounds(const ModelAsset& model, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+// Rebuilds world and the bounds if the placement is dirty. Returns true if it did.
+bool UpdateInstanceTransform(InstanceTransform& instance, const glm::mat4& parent,
+    const glm::vec3& localMin, const glm::vec3& localMax);
+
+// Builds every placement, uploads the matrices and attaches the buffer to
+// every mesh of the model. The placements must outlive the InstancedModel.
+void InitialiseInstancedModel(InstancedModel& instanced, ModelAsset& model, const glm::mat4& parent,
+    const std::vector<InstanceTransform*>& placements);
+
+// Rebuilds dirty placements and re-uploads the buffer if any changed - a few
+// flag checks for static scenery. Returns true if the buffer was re-uploaded.
+bool RefreshInstances(InstancedModel& instanced);
+
+// Fills the buffer with only the listed placements (ascending indices into
+// placements) and draws just those. Skips the upload if the list is the same
+// as last time. RefreshInstances puts every placement back when it uploads.
+void SetVisibleInstances(InstancedModel& instanced, const std::vector<int>& visible);
+
+void CleanupInstancedModel(InstancedModel& instanced);
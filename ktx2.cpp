@@ -0,0 +1,271 @@
+#include "ktx2.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+static const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+static const size_t KTX2_HEADER_SIZE = 80;      // identifier, header and index
+static const size_t KTX2_LEVEL_SIZE = 24;
+
+static const char* KTX2_SOURCE_HASH_KEY = "sourceHash";
+
+// Data Format Descriptor values (Khronos Data Format Specification 1.3)
+static const uint8_t KHR_DF_MODEL_BC1A = 128;
+static const uint8_t KHR_DF_MODEL_BC3 = 130;
+static const uint8_t KHR_DF_MODEL_BC7 = 134;
+static const uint8_t KHR_DF_PRIMARIES_BT709 = 1;
+static const uint8_t KHR_DF_TRANSFER_LINEAR = 1;
+static const uint8_t KHR_DF_CHANNEL_RED = 0;    // also "colour" for BC1/BC3/BC7
+static const uint8_t KHR_DF_CHANNEL_ALPHA = 15;
+
+// VkFormat values
+static uint32_t VkFormat(TextureCompression format)
+{
+    switch (format)
+    {
+    case TextureCompression::BC1: return 131;   // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+    case TextureCompression::BC3: return 137;   // VK_FORMAT_BC3_UNORM_BLOCK
+    case TextureCompression::BC7: return 145;   // VK_FORMAT_BC7_UNORM_BLOCK
+    default:                      return 0;
+    }
+}
+
+static TextureCompression FromVkFormat(uint32_t format)
+{
+    switch (format)
+    {
+    case 131: return TextureCompression::BC1;
+    case 137: return TextureCompression::BC3;
+    case 145: return TextureCompression::BC7;
+    default:  return TextureCompression::None;
+    }
+}
+
+static size_t LevelBytes(TextureCompression format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * CompressedBlockBytes(format);
+}
+
+static size_t Align(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+static void AppendValue(std::vector<unsigned char>& bytes, const T& value)
+{
+    const unsigned char* raw = (const unsigned char*)&value;
+    bytes.insert(bytes.end(), raw, raw + sizeof(T));
+}
+
+template <typename T>
+static void PutValue(std::vector<unsigned char>& bytes, size_t offset, const T& value)
+{
+    std::memcpy(&bytes[offset], &value, sizeof(T));
+}
+
+// One sample of the basic descriptor block: the whole block is one 64 or
+// 128 bit channel
+static void AppendSample(std::vector<unsigned char>& bytes, uint16_t bitOffset, uint8_t bitLength, uint8_t channel)
+{
+    AppendValue(bytes, bitOffset);
+    AppendValue(bytes, (uint8_t)(bitLength - 1));
+    AppendValue(bytes, channel);
+    AppendValue(bytes, (uint32_t)0);            // sample position
+    AppendValue(bytes, (uint32_t)0);            // lower
+    AppendValue(bytes, (uint32_t)0xFFFFFFFF);   // upper
+}
+
+static void AppendDataFormatDescriptor(std::vector<unsigned char>& bytes, TextureCompression format)
+{
+    size_t start = bytes.size();
+    AppendValue(bytes, (uint32_t)0);            // total size, filled in below
+    AppendValue(bytes, (uint32_t)0);            // Khronos vendor, basic descriptor type
+    AppendValue(bytes, (uint32_t)0);            // version 2, block size, filled in below
+
+    uint8_t model = KHR_DF_MODEL_BC1A;
+    if (format == TextureCompression::BC3)      model = KHR_DF_MODEL_BC3;
+    else if (format == TextureCompression::BC7) model = KHR_DF_MODEL_BC7;
+
+    AppendValue(bytes, model);
+    AppendValue(bytes, KHR_DF_PRIMARIES_BT709);
+    AppendValue(bytes, KHR_DF_TRANSFER_LINEAR);
+    AppendValue(bytes, (uint8_t)0);             // straight alpha
+
+    uint8_t dimensions[4] = { 3, 3, 0, 0 };     // 4x4x1x1 texels, minus one
+    bytes.insert(bytes.end(), dimensions, dimensions + 4);
+
+    uint8_t planes[8] = { (uint8_t)CompressedBlockBytes(format), 0, 0, 0, 0, 0, 0, 0 };
+    bytes.insert(bytes.end(), planes, planes + 8);
+
+    switch (format)
+    {
+    case TextureCompression::BC3:
+        AppendSample(bytes, 0, 64, KHR_DF_CHANNEL_ALPHA);
+        AppendSample(bytes, 64, 64, KHR_DF_CHANNEL_RED);
+        break;
+    case TextureCompression::BC7:
+        AppendSample(bytes, 0, 128, KHR_DF_CHANNEL_RED);
+        break;
+    default:
+        AppendSample(bytes, 0, 64, KHR_DF_CHANNEL_RED);
+        break;
+    }
+
+    uint32_t total = (uint32_t)(bytes.size() - start);
+    PutValue(bytes, start, total);
+    PutValue(bytes, start + 8, (uint32_t)(2 | ((total - 4) << 16)));
+}
+
+static void AppendKeyValue(std::vector<unsigned char>& bytes, const std::string& key, const std::string& value)
+{
+    AppendValue(bytes, (uint32_t)(key.size() + 1 + value.size() + 1));
+    bytes.insert(bytes.end(), key.begin(), key.end());
+    bytes.push_back(0);
+    bytes.insert(bytes.end(), value.begin(), value.end());
+    bytes.push_back(0);
+    bytes.resize(Align(bytes.size(), 4), 0);
+}
+
+bool WriteKtx2(const std::string& path, const CompressedImage& image, const unsigned char* data, uint64_t sourceHash)
+{
+    size_t blockBytes = CompressedBlockBytes(image.format);
+    if (blockBytes == 0 || image.levels.empty())
+        return false;
+
+    uint32_t levelCount = (uint32_t)image.levels.size();
+    std::vector<unsigned char> bytes(KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_SIZE, 0);
+
+    size_t dfdOffset = bytes.size();
+    AppendDataFormatDescriptor(bytes, image.format);
+    size_t kvdOffset = bytes.size();
+
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)sourceHash);
+    AppendKeyValue(bytes, "KTXwriter", "COMP3016 Lab 5 texture cache");
+    AppendKeyValue(bytes, KTX2_SOURCE_HASH_KEY, hash);
+    size_t kvdEnd = bytes.size();
+
+    // Smallest level first, as KTX2 lays them out
+    std::vector<size_t> levelOffsets(levelCount);
+    for (uint32_t level = levelCount; level-- > 0;)
+    {
+        bytes.resize(Align(bytes.size(), blockBytes), 0);
+        levelOffsets[level] = bytes.size();
+        bytes.insert(bytes.end(), data + image.levels[level].offset, data + image.levels[level].offset + image.levels[level].size);
+    }
+
+    std::memcpy(&bytes[0], KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    PutValue(bytes, 12, VkFormat(image.format));
+    PutValue(bytes, 16, (uint32_t)1);                            // typeSize
+    PutValue(bytes, 20, (uint32_t)image.levels[0].width);
+    PutValue(bytes, 24, (uint32_t)image.levels[0].height);
+    PutValue(bytes, 28, (uint32_t)0);                            // depth
+    PutValue(bytes, 32, (uint32_t)0);                            // layers
+    PutValue(bytes, 36, (uint32_t)1);                            // faces
+    PutValue(bytes, 40, levelCount);
+    PutValue(bytes, 44, (uint32_t)0);                            // supercompression
+    PutValue(bytes, 48, (uint32_t)dfdOffset);
+    PutValue(bytes, 52, (uint32_t)(kvdOffset - dfdOffset));
+    PutValue(bytes, 56, (uint32_t)kvdOffset);
+    PutValue(bytes, 60, (uint32_t)(kvdEnd - kvdOffset));
+    PutValue(bytes, 64, (uint64_t)0);                            // no supercompression global data
+    PutValue(bytes, 72, (uint64_t)0);
+
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        size_t entry = KTX2_HEADER_SIZE + level * KTX2_LEVEL_SIZE;
+        PutValue(bytes, entry, (uint64_t)levelOffsets[level]);
+        PutValue(bytes, entry + 8, (uint64_t)image.levels[level].size);
+        PutValue(bytes, entry + 16, (uint64_t)image.levels[level].size);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    out.write((const char*)bytes.data(), bytes.size());
+    return (bool)out;
+}
+
+// Finds sourceHash among the key/value entries
+static uint64_t ReadSourceHash(const unsigned char* at, const unsigned char* end)
+{
+    size_t keyLength = std::strlen(KTX2_SOURCE_HASH_KEY) + 1;
+
+    while (end - at >= 4)
+    {
+        uint32_t length = 0;
+        std::memcpy(&length, at, 4);
+        at += 4;
+
+        if (length > (size_t)(end - at))
+            break;
+
+        if (length > keyLength && std::memcmp(at, KTX2_SOURCE_HASH_KEY, keyLength) == 0 && at[length - 1] == 0)
+            return std::strtoull((const char*)at + keyLength, nullptr, 16);
+
+        at += Align(length, 4);
+    }
+
+    return 0;
+}
+
+bool ReadKtx2(const AssetFile& file, CompressedImage& image, uint64_t& sourceHash)
+{
+    image = CompressedImage();
+    sourceHash = 0;
+
+    AssetReader in(file);
+    const unsigned char* identifier = in.Take(sizeof(KTX2_IDENTIFIER));
+    if (identifier == nullptr || std::memcmp(identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+        return false;
+
+    uint32_t vkFormat = 0, typeSize = 0, width = 0, height = 0, depth = 0, layers = 0, faces = 0;
+    uint32_t levelCount = 0, supercompression = 0;
+    uint32_t dfdOffset = 0, dfdLength = 0, kvdOffset = 0, kvdLength = 0;
+    uint64_t sgdOffset = 0, sgdLength = 0;
+
+    bool ok = in.Read(vkFormat) && in.Read(typeSize) && in.Read(width) && in.Read(height)
+        && in.Read(depth) && in.Read(layers) && in.Read(faces) && in.Read(levelCount) && in.Read(supercompression)
+        && in.Read(dfdOffset) && in.Read(dfdLength) && in.Read(kvdOffset) && in.Read(kvdLength)
+        && in.Read(sgdOffset) && in.Read(sgdLength);
+
+    TextureCompression format = FromVkFormat(vkFormat);
+
+    // A full chain for a 2D texture is at most 32 levels
+    if (!ok || format == TextureCompression::None || width == 0 || height == 0 || depth != 0
+        || layers > 1 || faces != 1 || levelCount == 0 || levelCount > 32 || supercompression != 0)
+        return false;
+
+    if ((uint64_t)kvdOffset + kvdLength <= file.size)
+        sourceHash = ReadSourceHash(file.data + kvdOffset, file.data + kvdOffset + kvdLength);
+
+    image.format = format;
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        uint64_t offset = 0, length = 0, uncompressed = 0;
+        if (!in.Read(offset) || !in.Read(length) || !in.Read(uncompressed))
+            return false;
+
+        CompressedLevel compressed;
+        compressed.width = (int)std::max(width >> level, 1u);
+        compressed.height = (int)std::max(height >> level, 1u);
+        compressed.offset = (size_t)offset;
+        compressed.size = (size_t)length;
+
+        // Anything but exactly the blocks of the level is a broken file
+        if (length != LevelBytes(format, compressed.width, compressed.height) || offset > file.size
+            || length > file.size - offset)
+            return false;
+
+        image.levels.push_back(compressed);
+    }
+
+    return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "assetfile.h"
+#include "texturecompress.h"
+
+#include <cstdint>
+#include <string>
+
+// -----------------------------------------------------------------------------
+// KTX2 CONTAINER
+//
+// The Khronos KTX 2.0 layout for one 2D texture with a full mip chain:
+//
+//   identifier   "«KTX 20»\r\n\x1A\n"
+//   header       vkFormat, typeSize, width, height, depth 0, layers 0, faces 1,
+//                levelCount, supercompression 0
+//   index        DFD and key/value offsets and lengths (no supercompression data)
+//   level index  levelCount x { uint64 offset, uint64 length, uint64 uncompressedLength }
+//   DFD          one basic descriptor block naming the BCn colour model
+//   key/value    KTXwriter, and sourceHash - the texture cache's hash of the
+//                image the file was cooked from, as 16 hex digits
+//   levels       smallest first, each aligned to its block size
+//
+// Only what CompressTexture writes is read back: BC1, BC3 or BC7, UNORM.
+// -----------------------------------------------------------------------------
+
+// False if the file cannot be written
+bool WriteKtx2(const std::string& path, const CompressedImage& image, const unsigned char* data, uint64_t sourceHash);
+
+// Parses a mapped file. The level offsets are into file.data, so upload
+// straight from the mapping and keep it open until then. sourceHash is 0 if
+// the file has none.
+bool ReadKtx2(const AssetFile& file, CompressedImage& image, uint64_t& sourceHash);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "shaderprogram.h"
+
 #include <GLFW/glfw3.h>
 
 //Called on window resize
@@ -10,6 +12,6 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 //Processes user input on a particular window
 void ProcessUserInput(GLFWwindow* WindowIn);
 
-void SetMatrices(Shader& ShaderProgramIn);
+void SetMatrices(const ShaderProgram& ShaderProgramIn, UniformHandle ModelIn);
 
 GLuint program;
\ No newline at end of file
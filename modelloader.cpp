@@ -0,0 +1,564 @@
+#include "modelloader.h"
+#include "parallel.h"
+#include "assetfile.h"
+
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// Same post-processing as learnopengl's Model
+static const unsigned int MODEL_IMPORT_FLAGS =
+    aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+// -----------------------------------------------------------------------------
+// COOKED MESH CACHE (little-endian)
+//
+// char[4] "MSHB", uint32 version, uint32 sizeof(Vertex)
+// int64 sourceTime, int64 sourceSize, uint32 pathLength, char sourcePath[pathLength]
+// uint32 dependencyCount x { uint32 pathLength, char path[pathLength], int64 time, int64 size }
+// uint32 textureCount x { uint32 pathLength, char path[pathLength] }
+// uint32 meshCount    x { uint32 vertexCount, uint32 indexCount,
+//                         float boundsMin[3], float boundsMax[3],
+//                         uint32 textureCount x { uint32 typeLength, char type[typeLength], uint32 texture },
+//                         Vertex vertices[vertexCount], uint32 indices[indexCount] }
+//
+// Vertices are stored exactly as learnopengl's Vertex lays them out in the
+// VBO, so a load is a straight copy out of the mapped file - the Vertex size
+// check catches a layout change. The file is rebuilt whenever the time or
+// size of the source, or of any other file Assimp read for it (an OBJ's .mtl
+// material libraries), differ from the ones recorded. Counts and indices are
+// checked against the file, so a damaged cache is re-imported, never uploaded.
+// -----------------------------------------------------------------------------
+static const char MODEL_CACHE_MAGIC[4] = { 'M', 'S', 'H', 'B' };
+static const uint32_t MODEL_CACHE_VERSION = 2;
+
+static std::string ModelCachePath(const std::string& path)
+{
+    return path + ".meshb";
+}
+
+// Modification time and size, false if the file is missing
+static bool SourceStamp(const std::string& path, int64_t& time, int64_t& size)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+
+    time = (int64_t)info.st_mtime;
+    size = (int64_t)info.st_size;
+    return true;
+}
+
+// Another file the import read, with its stamp when it was read
+struct ModelDependency
+{
+    std::string path;
+    int64_t time = 0;
+    int64_t size = 0;
+};
+
+// Assimp's own file access, noting every file it opens besides the source
+class DependencyIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+    DependencyIOSystem(const std::string& source, std::vector<std::string>& opened)
+        : source(source), opened(opened) {}
+
+    Assimp::IOStream* Open(const char* file, const char* mode = "rb") override
+    {
+        Assimp::IOStream* stream = Assimp::DefaultIOSystem::Open(file, mode);
+        if (stream != nullptr && source != file && std::find(opened.begin(), opened.end(), file) == opened.end())
+            opened.push_back(file);
+        return stream;
+    }
+
+private:
+    std::string source;
+    std::vector<std::string>& opened;
+};
+
+template <typename T>
+static void WriteValue(std::ofstream& out, const T& value)
+{
+    out.write((const char*)&value, sizeof(T));
+}
+
+static void WriteString(std::ofstream& out, const std::string& value)
+{
+    WriteValue(out, (uint32_t)value.size());
+    out.write(value.data(), value.size());
+}
+
+static bool ReadString(AssetReader& in, std::string& value)
+{
+    uint32_t length = 0;
+    if (!in.Read(length) || length > 4096)
+        return false;
+
+    const unsigned char* text = in.Take(length);
+    if (text == nullptr)
+        return false;
+
+    value.assign((const char*)text, length);
+    return true;
+}
+
+static void WriteVec3(std::ofstream& out, const glm::vec3& value)
+{
+    WriteValue(out, value.x);
+    WriteValue(out, value.y);
+    WriteValue(out, value.z);
+}
+
+static bool ReadVec3(AssetReader& in, glm::vec3& value)
+{
+    return in.Read(value.x) && in.Read(value.y) && in.Read(value.z);
+}
+
+static void SaveModelCache(const std::string& cachePath, const ModelData& data, int64_t sourceTime, int64_t sourceSize,
+    const std::vector<ModelDependency>& dependencies)
+{
+    std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return;
+
+    out.write(MODEL_CACHE_MAGIC, 4);
+    WriteValue(out, MODEL_CACHE_VERSION);
+    WriteValue(out, (uint32_t)sizeof(Vertex));
+    WriteValue(out, sourceTime);
+    WriteValue(out, sourceSize);
+    WriteString(out, data.path);
+
+    WriteValue(out, (uint32_t)dependencies.size());
+    for (const ModelDependency& dependency : dependencies)
+    {
+        WriteString(out, dependency.path);
+        WriteValue(out, dependency.time);
+        WriteValue(out, dependency.size);
+    }
+
+    WriteValue(out, (uint32_t)data.textures.size());
+    for (const ModelTextureData& texture : data.textures)
+        WriteString(out, texture.path);
+
+    WriteValue(out, (uint32_t)data.meshes.size());
+    for (const ModelMeshData& mesh : data.meshes)
+    {
+        WriteValue(out, (uint32_t)mesh.vertices.size());
+        WriteValue(out, (uint32_t)mesh.indices.size());
+        WriteVec3(out, mesh.boundsMin);
+        WriteVec3(out, mesh.boundsMax);
+
+        WriteValue(out, (uint32_t)mesh.textures.size());
+        for (const std::pair<std::string, int>& texture : mesh.textures)
+        {
+            WriteString(out, texture.first);
+            WriteValue(out, (uint32_t)texture.second);
+        }
+
+        out.write((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+        out.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+    }
+}
+
+// False if the file is missing, truncated, damaged, for another source or out
+// of date. data keeps only the path and directory then.
+static bool LoadModelCache(const std::string& cachePath, ModelData& data, int64_t sourceTime, int64_t sourceSize)
+{
+    AssetFile file;
+    if (!OpenAssetFile(cachePath, file))
+        return false;
+
+    AssetReader in(file);
+    const unsigned char* magic = in.Take(4);
+    uint32_t version = 0;
+    uint32_t vertexSize = 0;
+    int64_t time = 0;
+    int64_t size = 0;
+    std::string sourcePath;
+    uint32_t dependencyCount = 0;
+    uint32_t textureCount = 0;
+
+    bool ok = magic != nullptr && std::equal(magic, magic + 4, MODEL_CACHE_MAGIC)
+        && in.Read(version) && version == MODEL_CACHE_VERSION
+        && in.Read(vertexSize) && vertexSize == sizeof(Vertex)
+        && in.Read(time) && time == sourceTime
+        && in.Read(size) && size == sourceSize
+        && ReadString(in, sourcePath) && sourcePath == data.path
+        && in.Read(dependencyCount);
+
+    for (uint32_t d = 0; ok && d < dependencyCount; d++)
+    {
+        ModelDependency recorded;
+        int64_t currentTime = 0;
+        int64_t currentSize = 0;
+        ok = ReadString(in, recorded.path) && in.Read(recorded.time) && in.Read(recorded.size)
+            && SourceStamp(recorded.path, currentTime, currentSize)
+            && currentTime == recorded.time && currentSize == recorded.size;
+    }
+
+    ok = ok && in.Read(textureCount);
+
+    for (uint32_t t = 0; ok && t < textureCount; t++)
+    {
+        ModelTextureData texture;
+        ok = ReadString(in, texture.path);
+        data.textures.push_back(std::move(texture));
+    }
+
+    uint32_t meshCount = 0;
+    ok = ok && in.Read(meshCount);
+
+    for (uint32_t m = 0; ok && m < meshCount; m++)
+    {
+        ModelMeshData mesh;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        uint32_t meshTextures = 0;
+
+        ok = in.Read(vertexCount) && in.Read(indexCount)
+            && ReadVec3(in, mesh.boundsMin) && ReadVec3(in, mesh.boundsMax)
+            && in.Read(meshTextures);
+
+        for (uint32_t t = 0; ok && t < meshTextures; t++)
+        {
+            std::string type;
+            uint32_t texture = 0;
+            ok = ReadString(in, type) && in.Read(texture) && texture < textureCount;
+            mesh.textures.push_back(std::make_pair(type, (int)texture));
+        }
+
+        if (!ok)
+            break;
+
+        // Sizes in 64 bits and against what is left, so a bad count can't wrap
+        // size_t on a 32-bit build or ask for more memory than the file holds
+        uint64_t vertexBytes = (uint64_t)vertexCount * sizeof(Vertex);
+        uint64_t indexBytes = (uint64_t)indexCount * sizeof(unsigned int);
+        if (vertexBytes + indexBytes > (uint64_t)in.Remaining())
+        {
+            ok = false;
+            break;
+        }
+
+        // learnopengl's Mesh keeps its own vectors, so this is the one copy
+        // left - memcpy also covers blobs that are not 4-byte aligned in the file
+        const unsigned char* vertices = in.Take((size_t)vertexBytes);
+        const unsigned char* indices = in.Take((size_t)indexBytes);
+        ok = vertices != nullptr && indices != nullptr;
+
+        if (ok)
+        {
+            mesh.vertices.resize(vertexCount);
+            mesh.indices.resize(indexCount);
+            std::memcpy(mesh.vertices.data(), vertices, (size_t)vertexBytes);
+            std::memcpy(mesh.indices.data(), indices, (size_t)indexBytes);
+
+            for (unsigned int index : mesh.indices)
+                ok = ok && index < vertexCount;
+
+            if (ok)
+                data.meshes.push_back(std::move(mesh));
+        }
+    }
+
+    CloseAssetFile(file);
+
+    if (!ok)
+    {
+        data.meshes.clear();
+        data.textures.clear();
+    }
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// IMPORT
+// -----------------------------------------------------------------------------
+static int ImportTexture(ModelData& data, std::map<std::string, int>& loaded, const std::string& path)
+{
+    auto found = loaded.find(path);
+    if (found != loaded.end())
+        return found->second;
+
+    ModelTextureData texture;
+    texture.path = path;
+
+    int index = (int)data.textures.size();
+    data.textures.push_back(std::move(texture));
+    loaded[path] = index;
+    return index;
+}
+
+// Requested last, so a cooked mesh and a fresh import share it. Only images
+// no other model has asked for yet are decoded here.
+static void RequestTextures(ModelData& data, TextureCache& textures)
+{
+    for (ModelTextureData& texture : data.textures)
+        texture.cacheEntry = RequestTexture(textures, data.directory + '/' + texture.path);
+}
+
+static void ImportMaterialTextures(ModelData& data, std::map<std::string, int>& loaded, const aiMaterial* material,
+    aiTextureType type, const std::string& typeName, ModelMeshData& mesh)
+{
+    for (unsigned int i = 0; i < material->GetTextureCount(type); i++)
+    {
+        aiString path;
+        material->GetTexture(type, i, &path);
+        mesh.textures.push_back(std::make_pair(typeName, ImportTexture(data, loaded, path.C_Str())));
+    }
+}
+
+static void ImportMesh(ModelData& data, std::map<std::string, int>& loaded, const aiScene* scene, const aiMesh* source)
+{
+    ModelMeshData mesh;
+    mesh.vertices.resize(source->mNumVertices);
+    mesh.boundsMin = glm::vec3(FLT_MAX);
+    mesh.boundsMax = glm::vec3(-FLT_MAX);
+
+    for (unsigned int i = 0; i < source->mNumVertices; i++)
+    {
+        Vertex vertex = {};
+        vertex.Position = glm::vec3(source->mVertices[i].x, source->mVertices[i].y, source->mVertices[i].z);
+
+        if (source->HasNormals())
+            vertex.Normal = glm::vec3(source->mNormals[i].x, source->mNormals[i].y, source->mNormals[i].z);
+
+        if (source->mTextureCoords[0])
+        {
+            vertex.TexCoords = glm::vec2(source->mTextureCoords[0][i].x, source->mTextureCoords[0][i].y);
+            vertex.Tangent = glm::vec3(source->mTangents[i].x, source->mTangents[i].y, source->mTangents[i].z);
+            vertex.Bitangent = glm::vec3(source->mBitangents[i].x, source->mBitangents[i].y, source->mBitangents[i].z);
+        }
+
+        mesh.vertices[i] = vertex;
+        mesh.boundsMin = glm::min(mesh.boundsMin, vertex.Position);
+        mesh.boundsMax = glm::max(mesh.boundsMax, vertex.Position);
+    }
+
+    for (unsigned int f = 0; f < source->mNumFaces; f++)
+    {
+        const aiFace& face = source->mFaces[f];
+        mesh.indices.insert(mesh.indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+    }
+
+    // Same sampler types learnopengl assigns, in the same order
+    const aiMaterial* material = scene->mMaterials[source->mMaterialIndex];
+    ImportMaterialTextures(data, loaded, material, aiTextureType_DIFFUSE, "texture_diffuse", mesh);
+    ImportMaterialTextures(data, loaded, material, aiTextureType_SPECULAR, "texture_specular", mesh);
+    ImportMaterialTextures(data, loaded, material, aiTextureType_HEIGHT, "texture_normal", mesh);
+    ImportMaterialTextures(data, loaded, material, aiTextureType_AMBIENT, "texture_height", mesh);
+
+    data.meshes.push_back(std::move(mesh));
+}
+
+static void ImportNode(ModelData& data, std::map<std::string, int>& loaded, const aiScene* scene, const aiNode* node)
+{
+    for (unsigned int i = 0; i < node->mNumMeshes; i++)
+        ImportMesh(data, loaded, scene, scene->mMeshes[node->mMeshes[i]]);
+
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+        ImportNode(data, loaded, scene, node->mChildren[i]);
+}
+
+bool ImportModelData(const std::string& path, ModelData& data, TextureCache& textures)
+{
+    data = ModelData();
+    data.path = path;
+    data.directory = path.substr(0, path.find_last_of('/'));
+
+    int64_t sourceTime = 0;
+    int64_t sourceSize = 0;
+    bool stamped = SourceStamp(path, sourceTime, sourceSize);
+    std::string cachePath = ModelCachePath(path);
+
+    if (stamped && LoadModelCache(cachePath, data, sourceTime, sourceSize))
+    {
+        data.cooked = true;
+        data.imported = true;
+        RequestTextures(data, textures);
+        return true;
+    }
+
+    // One importer per call - Assimp importers are not shared between threads.
+    // The importer owns and deletes the IO system.
+    std::vector<std::string> opened;
+    Assimp::Importer importer;
+    importer.SetIOHandler(new DependencyIOSystem(path, opened));
+    const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+
+    if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->mRootNode)
+    {
+        std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << "\n";
+        return false;
+    }
+
+    std::map<std::string, int> loaded;
+    ImportNode(data, loaded, scene, scene->mRootNode);
+
+    // Without a cache the next start just imports again, so this can fail quietly.
+    // A dependency that can't be stamped couldn't be checked, so nothing is cached.
+    std::vector<ModelDependency> dependencies(opened.size());
+    for (size_t i = 0; stamped && i < opened.size(); i++)
+    {
+        dependencies[i].path = opened[i];
+        stamped = SourceStamp(opened[i], dependencies[i].time, dependencies[i].size);
+    }
+
+    if (stamped)
+        SaveModelCache(cachePath, data, sourceTime, sourceSize, dependencies);
+
+    RequestTextures(data, textures);
+    data.imported = true;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// UPLOAD
+// -----------------------------------------------------------------------------
+void UploadModelData(ModelData& data, ModelAsset& model, TextureCache& textures)
+{
+    model = ModelAsset();
+    model.path = data.path;
+    model.boundsMin = glm::vec3(FLT_MAX);
+    model.boundsMax = glm::vec3(-FLT_MAX);
+
+    for (const ModelTextureData& source : data.textures)
+    {
+        Texture texture;
+        texture.id = AcquireTexture(textures, source.cacheEntry);
+        texture.path = source.path;
+        model.textures.push_back(texture);
+    }
+
+    model.meshes.reserve(data.meshes.size());
+
+    for (ModelMeshData& source : data.meshes)
+    {
+        std::vector<Texture> meshTextures;
+        for (const std::pair<std::string, int>& used : source.textures)
+        {
+            Texture texture = model.textures[used.second];
+            texture.type = used.first;
+            meshTextures.push_back(texture);
+        }
+
+        if (!source.vertices.empty())
+        {
+            model.boundsMin = glm::min(model.boundsMin, source.boundsMin);
+            model.boundsMax = glm::max(model.boundsMax, source.boundsMax);
+        }
+
+        // Mesh's constructor creates the VAO and buffers
+        model.meshes.push_back(Mesh(std::move(source.vertices), std::move(source.indices), meshTextures));
+    }
+
+    data.meshes.clear();
+}
+
+// -----------------------------------------------------------------------------
+// PARALLEL LOAD
+// -----------------------------------------------------------------------------
+void LoadModels(const std::vector<std::string>& paths, std::vector<std::unique_ptr<ModelAsset>>& models,
+    TextureCache& textures, int threadCount)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const int count = (int)paths.size();
+    models.clear();
+    models.resize(count);
+
+    std::vector<ModelData> data(count);
+    std::vector<char> ready(count, 0);
+    std::mutex mutex;
+    std::condition_variable readyChanged;
+
+    // Workers take the next model as they finish one, since import times vary
+    // far more between models than ParallelFor's even blocks would suit
+    std::atomic<int> next(0);
+    int workerCount = std::max(1, std::min(ResolveThreadCount(threadCount), count));
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < workerCount; w++)
+    {
+        workers.emplace_back([&]()
+        {
+            for (int i = next++; i < count; i = next++)
+            {
+                ImportModelData(paths[i], data[i], textures);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                ready[i] = 1;
+                readyChanged.notify_one();
+            }
+        });
+    }
+
+    // Upload in whatever order the imports finish
+    for (int uploaded = 0; uploaded < count; uploaded++)
+    {
+        int index = -1;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            readyChanged.wait(lock, [&]()
+            {
+                auto found = std::find(ready.begin(), ready.end(), 1);
+                index = found != ready.end() ? (int)(found - ready.begin()) : -1;
+                return index >= 0;
+            });
+            ready[index] = 2;
+        }
+
+        models[index].reset(new ModelAsset());
+        UploadModelData(data[index], *models[index], textures);
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Models: " << count << " loaded on " << workerCount << " threads in "
+        << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+}
+
+void ReleaseModelTextures(ModelAsset& model, TextureCache& textures)
+{
+    for (Texture& texture : model.textures)
+    {
+        ReleaseTexture(textures, texture.id);
+        texture.id = 0;
+    }
+
+    for (Mesh& mesh : model.meshes)
+    {
+        for (Texture& texture : mesh.textures)
+            texture.id = 0;
+    }
+}
+
+void CleanupModelAsset(ModelAsset& model, TextureCache& textures)
+{
+    for (const Texture& texture : model.textures)
+        ReleaseTexture(textures, texture.id);
+
+    model.textures.clear();
+    model.meshes.clear();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/mesh.h>
+
+#include "texturecache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// MODEL LOADING
+//
+// Loading a model is split into two halves:
+//   1. Import (any thread): Assimp reads and post-processes the file, the
+//      node tree is flattened into vertex and index arrays the way learnopengl's
+//      Model does it, and every texture the materials name is requested from
+//      the texture cache, which decodes (or loads the cooked copy of) each
+//      distinct image once. A cooked copy of the meshes (<model>.meshb) is
+//      written the first time and read instead of running Assimp while it
+//      is current.
+//   2. Upload (GL context thread): the Meshes are built - which creates their
+//      VAOs and buffers - and the textures are acquired from the cache, which
+//      uploads each image the first time any model asks for it.
+//
+// LoadModels runs step 1 for every model on a pool of worker threads and
+// step 2 on the calling thread as each import finishes, so the uploads
+// overlap the imports still running.
+// -----------------------------------------------------------------------------
+
+// One image, shared by every mesh of the model that uses it
+struct ModelTextureData
+{
+    std::string path;                  // as the material names it, relative to the model
+    int cacheEntry = -1;               // RequestTexture result
+};
+
+struct ModelMeshData
+{
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    glm::vec3 boundsMin = glm::vec3(0.0f);   // model space
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    // (sampler type, index into ModelData::textures), in Mesh::textures order
+    std::vector<std::pair<std::string, int>> textures;
+};
+
+// Step 1 output - plain memory, nothing touches GL
+struct ModelData
+{
+    std::string path;
+    std::string directory;
+    bool imported = false;
+    bool cooked = false;               // read from the mesh cache, Assimp never ran
+
+    std::vector<ModelMeshData> meshes;
+    std::vector<ModelTextureData> textures;
+};
+
+// Step 2 output. Stands in for learnopengl's Model, whose constructor can only
+// do both halves at once on the context thread.
+struct ModelAsset
+{
+    std::string path;
+    std::vector<Mesh> meshes;
+    std::vector<Texture> textures;     // one per ModelData texture, each holding a cache reference
+
+    // Union of the meshes' bounds - both FLT_MAX/-FLT_MAX if there are none
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+// Safe on any thread. Uses the mesh cache when it matches the source file's
+// time and size, otherwise runs Assimp and rewrites the cache. Returns false
+// (with a message) if Assimp rejects the file.
+bool ImportModelData(const std::string& path, ModelData& data, TextureCache& textures);
+
+// Context thread only. Releases the vertex memory of data as it goes.
+void UploadModelData(ModelData& data, ModelAsset& model, TextureCache& textures);
+
+// Loads every path in parallel. models[i] is paths[i]; a model that fails to
+// import comes back with no meshes. threadCount as in parallel.h.
+void LoadModels(const std::vector<std::string>& paths, std::vector<std::unique_ptr<ModelAsset>>& models,
+    TextureCache& textures, int threadCount = 0);
+
+// Drops the model's texture references and zeroes the ids its meshes hold,
+// for when nothing will draw the model through its own meshes again
+void ReleaseModelTextures(ModelAsset& model, TextureCache& textures);
+
+// Gives the model's texture references back to the cache. The meshes' buffers
+// belong to learnopengl's Mesh and go with the context.
+void CleanupModelAsset(ModelAsset& model, TextureCache& textures);
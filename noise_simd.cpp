@@ -0,0 +1,204 @@
+#include "noise_simd.h"
+
+#include <algorithm>
+
+#if NOISE_SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <emmintrin.h>
+
+#include "noise_simd_kernel.h"
+
+// -----------------------------------------------------------------------------
+// CPU FEATURES
+// -----------------------------------------------------------------------------
+static void CpuId(int leaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r, leaf, 0);
+    for (int i = 0; i < 4; i++)
+        regs[i] = (unsigned int)r[i];
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long ReadXcr0()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+static NoiseSimdLevel QueryLevel()
+{
+    unsigned int regs[4];
+
+    CpuId(0, regs);
+    unsigned int maxLeaf = regs[0];
+
+    CpuId(1, regs);
+    bool sse2 = (regs[3] & (1u << 26)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+
+    // The CPU having AVX is not enough - the OS has to save the ymm registers too
+    bool ymmSaved = osxsave && avx && (ReadXcr0() & 6) == 6;
+
+    bool avx2 = false;
+    if (maxLeaf >= 7)
+    {
+        CpuId(7, regs);
+        avx2 = ymmSaved && (regs[1] & (1u << 5)) != 0;
+    }
+
+    return avx2 ? NoiseSimdLevel::AVX2 : sse2 ? NoiseSimdLevel::SSE2 : NoiseSimdLevel::Scalar;
+}
+
+// -----------------------------------------------------------------------------
+// SSE2 KERNEL
+// -----------------------------------------------------------------------------
+struct NoiseOpsSSE2
+{
+    typedef __m128 Float;
+    typedef __m128i Int;
+    static const int Width = 4;
+
+    static Float Set(float v) { return _mm_set1_ps(v); }
+    static Int SetInt(int v) { return _mm_set1_epi32(v); }
+    static Float Lanes() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+
+    static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }   // a < b ? a : b, like FastMin
+    static Float Abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+    static Float Less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+    static Float LessEqual(Float a, Float b) { return _mm_cmple_ps(a, b); }
+    static Float Select(Float mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    static Int SelectInt(Float mask, Int a, Int b)
+    {
+        Int m = _mm_castps_si128(mask);
+        return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+    }
+
+    // FastFloor: truncate, then one lower for negatives (the mask is -1 there)
+    static Int Floor(Float f) { return _mm_add_epi32(_mm_cvttps_epi32(f), _mm_castps_si128(_mm_cmplt_ps(f, _mm_setzero_ps()))); }
+    static Float ToFloat(Int i) { return _mm_cvtepi32_ps(i); }
+
+    static Int AddInt(Int a, Int b) { return _mm_add_epi32(a, b); }
+    static Int Xor(Int a, Int b) { return _mm_xor_si128(a, b); }
+    static Int And(Int a, Int b) { return _mm_and_si128(a, b); }
+    static Int ShiftRight15(Int a) { return _mm_srai_epi32(a, 15); }
+
+    // No 32-bit multiply before SSE4.1 - do the even and odd lanes as 64-bit products
+    static Int MulInt(Int a, Int b)
+    {
+        Int even = _mm_mul_epu32(a, b);
+        Int odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    // No gather either
+    static Float Gather(const float* table, Int index)
+    {
+        alignas(16) int i[4];
+        _mm_store_si128((Int*)i, index);
+        return _mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+    }
+
+    static void Store(float* output, Float v) { _mm_storeu_ps(output, v); }
+};
+
+int NoiseSimd::RowSSE2(const FastNoiseLite& noise, float* output, int count, float x, float y, float stepX, float stepY)
+{
+    return Row<NoiseOpsSSE2>(noise, output, count, x, y, stepX, stepY);
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// DISPATCH
+// -----------------------------------------------------------------------------
+NoiseSimdLevel NoiseSimd::DetectLevel()
+{
+#if NOISE_SIMD_X86
+    static const NoiseSimdLevel level = QueryLevel();
+    return level;
+#else
+    return NoiseSimdLevel::Scalar;
+#endif
+}
+
+bool NoiseSimd::Supports(const FastNoiseLite& noise)
+{
+    bool noiseType = noise.mNoiseType == FastNoiseLite::NoiseType_OpenSimplex2
+        || noise.mNoiseType == FastNoiseLite::NoiseType_Perlin;
+    bool fractalType = noise.mFractalType == FastNoiseLite::FractalType_None
+        || noise.mFractalType == FastNoiseLite::FractalType_FBm
+        || noise.mFractalType == FastNoiseLite::FractalType_Ridged;
+
+    return noiseType && fractalType;
+}
+
+void NoiseSimd::GetNoiseGrid(const FastNoiseLite& noise, float* output, float xStart, float yStart,
+    int xSize, int ySize, float xStep, float yStep, NoiseSimdLevel maxLevel)
+{
+    NoiseSimdLevel level = std::min(DetectLevel(), maxLevel);
+
+    if (level == NoiseSimdLevel::Scalar || !Supports(noise))
+    {
+        noise.GetNoiseGrid(output, xStart, yStart, xSize, ySize, xStep, yStep);
+        return;
+    }
+
+#if NOISE_SIMD_X86
+    // Same transform setup as FastNoiseLite::GetNoiseGrid
+    float rowStepX = xStep, rowStepY = 0;
+    float colStepX = 0, colStepY = yStep;
+    noise.TransformNoiseCoordinate(rowStepX, rowStepY);
+    noise.TransformNoiseCoordinate(colStepX, colStepY);
+
+    float originX = xStart, originY = yStart;
+    noise.TransformNoiseCoordinate(originX, originY);
+
+    for (int y = 0; y < ySize; y++)
+    {
+        float rowX = originX + colStepX * y;
+        float rowY = originY + colStepY * y;
+        float* row = output + (size_t)y * xSize;
+
+        int done = (level == NoiseSimdLevel::AVX2)
+            ? RowAVX2(noise, row, xSize, rowX, rowY, rowStepX, rowStepY)
+            : RowSSE2(noise, row, xSize, rowX, rowY, rowStepX, rowStepY);
+
+        // Whatever doesn't fill a whole vector goes through the scalar code
+        for (int x = done; x < xSize; x++)
+        {
+            float px = rowX + rowStepX * x;
+            float py = rowY + rowStepY * x;
+
+            switch (noise.mFractalType)
+            {
+            default:
+                row[x] = noise.GenNoiseSingle(noise.mSeed, px, py);
+                break;
+            case FastNoiseLite::FractalType_FBm:
+                row[x] = noise.GenFractalFBm(px, py);
+                break;
+            case FastNoiseLite::FractalType_Ridged:
+                row[x] = noise.GenFractalRidged(px, py);
+                break;
+            }
+        }
+    }
+#endif
+}
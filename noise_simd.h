@@ -0,0 +1,60 @@
+#pragma once
+
+#include "FastNoiseLite.h"
+
+// -----------------------------------------------------------------------------
+// SIMD NOISE
+//
+// 4-wide (SSE2) and 8-wide (AVX2) versions of FastNoiseLite's 2D OpenSimplex2
+// and Perlin noise, on their own or under FBm / ridged fractals. The
+// instruction set is picked once at runtime from CPUID; any other noise or
+// fractal setting, and any CPU without SSE2, falls back to
+// FastNoiseLite::GetNoiseGrid.
+//
+// Each lane follows the scalar code operation for operation, with no fused
+// multiply-adds, so results match the scalar path to NOISE_SIMD_TOLERANCE
+// (in practice they come out bit-identical).
+// -----------------------------------------------------------------------------
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define NOISE_SIMD_X86 1
+#else
+#define NOISE_SIMD_X86 0
+#endif
+
+constexpr float NOISE_SIMD_TOLERANCE = 1e-6f;
+
+// Best last, so levels can be compared
+enum class NoiseSimdLevel
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+struct NoiseSimd
+{
+    // What this CPU (and OS) can run - worked out on the first call
+    static NoiseSimdLevel DetectLevel();
+
+    // True if the noise type and fractal type have SIMD kernels
+    static bool Supports(const FastNoiseLite& noise);
+
+    // Same contract as FastNoiseLite::GetNoiseGrid.
+    // maxLevel caps the instruction set, e.g. to compare against the scalar path.
+    //
+    // Sample (x, y) is at start + index * step, rounded in float, so splitting
+    // one grid into several calls moves the samples by an ulp or so. Callers
+    // that split work across threads should make one call per row with that
+    // row's own start, as BakeHeights does.
+    static void GetNoiseGrid(const FastNoiseLite& noise, float* output, float xStart, float yStart,
+        int xSize, int ySize, float xStep, float yStep, NoiseSimdLevel maxLevel = NoiseSimdLevel::AVX2);
+
+private:
+    // Fills whole vectors of one row from already transformed coordinates and
+    // returns how many samples were written - the caller does the tail
+    template <typename Ops>
+    static int Row(const FastNoiseLite& noise, float* output, int count, float x, float y, float stepX, float stepY);
+
+    static int RowSSE2(const FastNoiseLite& noise, float* output, int count, float x, float y, float stepX, float stepY);
+    static int RowAVX2(const FastNoiseLite& noise, float* output, int count, float x, float y, float stepX, float stepY);
+};
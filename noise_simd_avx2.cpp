@@ -0,0 +1,67 @@
+#include "noise_simd.h"
+
+#if NOISE_SIMD_X86
+#include <immintrin.h>
+
+// Only reached once NoiseSimd::DetectLevel has seen AVX2. MSVC emits AVX2
+// intrinsics without any /arch flag; GCC and Clang need the target switched
+// on, which is kept to the kernel so nothing shared with other files is
+// built for AVX2.
+#if defined(__GNUC__) && !defined(__AVX2__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#define NOISE_SIMD_AVX2_PRAGMA
+#endif
+
+#include "noise_simd_kernel.h"
+
+// -----------------------------------------------------------------------------
+// AVX2 KERNEL
+// -----------------------------------------------------------------------------
+struct NoiseOpsAVX2
+{
+    typedef __m256 Float;
+    typedef __m256i Int;
+    static const int Width = 8;
+
+    static Float Set(float v) { return _mm256_set1_ps(v); }
+    static Int SetInt(int v) { return _mm256_set1_epi32(v); }
+    static Float Lanes() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+
+    static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }   // a < b ? a : b, like FastMin
+    static Float Abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+    static Float Less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static Float LessEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static Float Select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+    static Int SelectInt(Float mask, Int a, Int b) { return _mm256_blendv_epi8(b, a, _mm256_castps_si256(mask)); }
+
+    // FastFloor: truncate, then one lower for negatives (the mask is -1 there)
+    static Int Floor(Float f)
+    {
+        return _mm256_add_epi32(_mm256_cvttps_epi32(f), _mm256_castps_si256(_mm256_cmp_ps(f, _mm256_setzero_ps(), _CMP_LT_OQ)));
+    }
+    static Float ToFloat(Int i) { return _mm256_cvtepi32_ps(i); }
+
+    static Int AddInt(Int a, Int b) { return _mm256_add_epi32(a, b); }
+    static Int MulInt(Int a, Int b) { return _mm256_mullo_epi32(a, b); }
+    static Int Xor(Int a, Int b) { return _mm256_xor_si256(a, b); }
+    static Int And(Int a, Int b) { return _mm256_and_si256(a, b); }
+    static Int ShiftRight15(Int a) { return _mm256_srai_epi32(a, 15); }
+
+    static Float Gather(const float* table, Int index) { return _mm256_i32gather_ps(table, index, 4); }
+    static void Store(float* output, Float v) { _mm256_storeu_ps(output, v); }
+};
+
+int NoiseSimd::RowAVX2(const FastNoiseLite& noise, float* output, int count, float x, float y, float stepX, float stepY)
+{
+    return Row<NoiseOpsAVX2>(noise, output, count, x, y, stepX, stepY);
+}
+
+#ifdef NOISE_SIMD_AVX2_PRAGMA
+#pragma GCC pop_options
+#endif
+#endif
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "noise_simd.h"
+
+// -----------------------------------------------------------------------------
+// SIMD NOISE KERNEL
+//
+// Shared body of the vector kernels. noise_simd.cpp (SSE2) and
+// noise_simd_avx2.cpp (AVX2) each include this after defining an Ops struct
+// that wraps their intrinsics:
+//
+//   Float / Int, Width, Set, SetInt, Lanes, Add, Sub, Mul, Min, Abs,
+//   Less, LessEqual (all-ones lane masks), Select, SelectInt, Floor, ToFloat,
+//   AddInt, MulInt, Xor, And, ShiftRight15, Gather, Store
+//
+// Everything below mirrors FastNoiseLite's scalar code line for line - keep
+// the operation order the same or the results stop matching.
+// -----------------------------------------------------------------------------
+
+// FastNoiseLite::Lerp: a + t * (b - a)
+template <typename Ops>
+inline typename Ops::Float NoiseSimdLerp(typename Ops::Float a, typename Ops::Float b, typename Ops::Float t)
+{
+    return Ops::Add(a, Ops::Mul(t, Ops::Sub(b, a)));
+}
+
+// FastNoiseLite::InterpQuintic: t * t * t * (t * (t * 6 - 15) + 10)
+template <typename Ops>
+inline typename Ops::Float NoiseSimdQuintic(typename Ops::Float t)
+{
+    typename Ops::Float inner = Ops::Add(Ops::Mul(t, Ops::Sub(Ops::Mul(t, Ops::Set(6.0f)), Ops::Set(15.0f))), Ops::Set(10.0f));
+    return Ops::Mul(Ops::Mul(Ops::Mul(t, t), t), inner);
+}
+
+// FastNoiseLite::GradCoord
+template <typename Ops>
+inline typename Ops::Float NoiseSimdGrad(typename Ops::Int seed, typename Ops::Int xPrimed, typename Ops::Int yPrimed,
+    typename Ops::Float xd, typename Ops::Float yd, const float* gradients)
+{
+    typedef typename Ops::Int Int;
+    typedef typename Ops::Float Float;
+
+    Int hash = Ops::MulInt(Ops::Xor(Ops::Xor(seed, xPrimed), yPrimed), Ops::SetInt(0x27d4eb2d));
+    hash = Ops::Xor(hash, Ops::ShiftRight15(hash));
+    hash = Ops::And(hash, Ops::SetInt(127 << 1));
+
+    Float xg = Ops::Gather(gradients, hash);
+    Float yg = Ops::Gather(gradients + 1, hash);
+
+    return Ops::Add(Ops::Mul(xd, xg), Ops::Mul(yd, yg));
+}
+
+// FastNoiseLite::SingleSimplex - the skew has already been applied to x/y
+template <typename Ops>
+inline typename Ops::Float NoiseSimdSimplex(int seed, typename Ops::Float x, typename Ops::Float y,
+    const float* gradients, int primeX, int primeY)
+{
+    typedef typename Ops::Int Int;
+    typedef typename Ops::Float Float;
+
+    const float SQRT3 = 1.7320508075688772935274463415059f;
+    const float G2 = (3 - SQRT3) / 6;
+
+    const Float zero = Ops::Set(0.0f);
+    const Int seeds = Ops::SetInt(seed);
+
+    Int i = Ops::Floor(x);
+    Int j = Ops::Floor(y);
+    Float xi = Ops::Sub(x, Ops::ToFloat(i));
+    Float yi = Ops::Sub(y, Ops::ToFloat(j));
+
+    Float t = Ops::Mul(Ops::Add(xi, yi), Ops::Set(G2));
+    Float x0 = Ops::Sub(xi, t);
+    Float y0 = Ops::Sub(yi, t);
+
+    i = Ops::MulInt(i, Ops::SetInt(primeX));
+    j = Ops::MulInt(j, Ops::SetInt(primeY));
+
+    Float a = Ops::Sub(Ops::Sub(Ops::Set(0.5f), Ops::Mul(x0, x0)), Ops::Mul(y0, y0));
+    Float a4 = Ops::Mul(Ops::Mul(a, a), Ops::Mul(a, a));
+    Float n0 = Ops::Select(Ops::LessEqual(a, zero), zero,
+        Ops::Mul(a4, NoiseSimdGrad<Ops>(seeds, i, j, x0, y0, gradients)));
+
+    Float c = Ops::Add(Ops::Mul(Ops::Set((float)(2 * (1 - 2 * G2) * (1 / G2 - 2))), t),
+        Ops::Add(Ops::Set((float)(-2 * (1 - 2 * G2) * (1 - 2 * G2))), a));
+    Float x2 = Ops::Add(x0, Ops::Set(2 * (float)G2 - 1));
+    Float y2 = Ops::Add(y0, Ops::Set(2 * (float)G2 - 1));
+    Float c4 = Ops::Mul(Ops::Mul(c, c), Ops::Mul(c, c));
+    Float n2 = Ops::Select(Ops::LessEqual(c, zero), zero,
+        Ops::Mul(c4, NoiseSimdGrad<Ops>(seeds, Ops::AddInt(i, Ops::SetInt(primeX)), Ops::AddInt(j, Ops::SetInt(primeY)), x2, y2, gradients)));
+
+    // Middle corner: (0, 1) above the diagonal, (1, 0) below it
+    Float upper = Ops::Less(x0, y0);
+    Float x1 = Ops::Select(upper, Ops::Add(x0, Ops::Set((float)G2)), Ops::Add(x0, Ops::Set((float)G2 - 1)));
+    Float y1 = Ops::Select(upper, Ops::Add(y0, Ops::Set((float)G2 - 1)), Ops::Add(y0, Ops::Set((float)G2)));
+    Int i1 = Ops::SelectInt(upper, i, Ops::AddInt(i, Ops::SetInt(primeX)));
+    Int j1 = Ops::SelectInt(upper, Ops::AddInt(j, Ops::SetInt(primeY)), j);
+
+    Float b = Ops::Sub(Ops::Sub(Ops::Set(0.5f), Ops::Mul(x1, x1)), Ops::Mul(y1, y1));
+    Float b4 = Ops::Mul(Ops::Mul(b, b), Ops::Mul(b, b));
+    Float n1 = Ops::Select(Ops::LessEqual(b, zero), zero,
+        Ops::Mul(b4, NoiseSimdGrad<Ops>(seeds, i1, j1, x1, y1, gradients)));
+
+    return Ops::Mul(Ops::Add(Ops::Add(n0, n1), n2), Ops::Set(99.83685446303647f));
+}
+
+// FastNoiseLite::SinglePerlin
+template <typename Ops>
+inline typename Ops::Float NoiseSimdPerlin(int seed, typename Ops::Float x, typename Ops::Float y,
+    const float* gradients, int primeX, int primeY)
+{
+    typedef typename Ops::Int Int;
+    typedef typename Ops::Float Float;
+
+    const Float one = Ops::Set(1.0f);
+    const Int seeds = Ops::SetInt(seed);
+
+    Int x0 = Ops::Floor(x);
+    Int y0 = Ops::Floor(y);
+
+    Float xd0 = Ops::Sub(x, Ops::ToFloat(x0));
+    Float yd0 = Ops::Sub(y, Ops::ToFloat(y0));
+    Float xd1 = Ops::Sub(xd0, one);
+    Float yd1 = Ops::Sub(yd0, one);
+
+    Float xs = NoiseSimdQuintic<Ops>(xd0);
+    Float ys = NoiseSimdQuintic<Ops>(yd0);
+
+    x0 = Ops::MulInt(x0, Ops::SetInt(primeX));
+    y0 = Ops::MulInt(y0, Ops::SetInt(primeY));
+    Int x1 = Ops::AddInt(x0, Ops::SetInt(primeX));
+    Int y1 = Ops::AddInt(y0, Ops::SetInt(primeY));
+
+    Float xf0 = NoiseSimdLerp<Ops>(NoiseSimdGrad<Ops>(seeds, x0, y0, xd0, yd0, gradients),
+        NoiseSimdGrad<Ops>(seeds, x1, y0, xd1, yd0, gradients), xs);
+    Float xf1 = NoiseSimdLerp<Ops>(NoiseSimdGrad<Ops>(seeds, x0, y1, xd0, yd1, gradients),
+        NoiseSimdGrad<Ops>(seeds, x1, y1, xd1, yd1, gradients), xs);
+
+    return Ops::Mul(NoiseSimdLerp<Ops>(xf0, xf1, ys), Ops::Set(1.4247691104677813f));
+}
+
+// FastNoiseLite::GenNoiseSingle, for the two types with kernels
+template <typename Ops>
+inline typename Ops::Float NoiseSimdSingle(bool perlin, int seed, typename Ops::Float x, typename Ops::Float y,
+    const float* gradients, int primeX, int primeY)
+{
+    return perlin
+        ? NoiseSimdPerlin<Ops>(seed, x, y, gradients, primeX, primeY)
+        : NoiseSimdSimplex<Ops>(seed, x, y, gradients, primeX, primeY);
+}
+
+template <typename Ops>
+int NoiseSimd::Row(const FastNoiseLite& noise, float* output, int count, float x, float y, float stepX, float stepY)
+{
+    typedef typename Ops::Float Float;
+
+    const float* gradients = FastNoiseLite::Lookup<float>::Gradients2D;
+    const int primeX = FastNoiseLite::PrimeX;
+    const int primeY = FastNoiseLite::PrimeY;
+    const bool perlin = noise.mNoiseType == FastNoiseLite::NoiseType_Perlin;
+
+    int done = 0;
+    for (; done + Ops::Width <= count; done += Ops::Width)
+    {
+        // start + step * index, as in GetNoiseGrid
+        Float index = Ops::Add(Ops::Set((float)done), Ops::Lanes());
+        Float px = Ops::Add(Ops::Set(x), Ops::Mul(Ops::Set(stepX), index));
+        Float py = Ops::Add(Ops::Set(y), Ops::Mul(Ops::Set(stepY), index));
+
+        if (noise.mFractalType == FastNoiseLite::FractalType_None)
+        {
+            Ops::Store(output + done, NoiseSimdSingle<Ops>(perlin, noise.mSeed, px, py, gradients, primeX, primeY));
+            continue;
+        }
+
+        // FastNoiseLite::GenFractalFBm / GenFractalRidged
+        const bool ridged = noise.mFractalType == FastNoiseLite::FractalType_Ridged;
+        int seed = noise.mSeed;
+        Float sum = Ops::Set(0.0f);
+        Float amp = Ops::Set(noise.mFractalBounding);
+
+        for (int octave = 0; octave < noise.mOctaves; octave++)
+        {
+            Float value = NoiseSimdSingle<Ops>(perlin, seed++, px, py, gradients, primeX, primeY);
+            Float weight;
+
+            if (ridged)
+            {
+                value = Ops::Abs(value);
+                sum = Ops::Add(sum, Ops::Mul(Ops::Add(Ops::Mul(value, Ops::Set(-2.0f)), Ops::Set(1.0f)), amp));
+                weight = Ops::Sub(Ops::Set(1.0f), value);
+            }
+            else
+            {
+                sum = Ops::Add(sum, Ops::Mul(value, amp));
+                weight = Ops::Mul(Ops::Min(Ops::Add(value, Ops::Set(1.0f)), Ops::Set(2.0f)), Ops::Set(0.5f));
+            }
+
+            amp = Ops::Mul(amp, Ops::Add(Ops::Set(1.0f), Ops::Mul(Ops::Set(noise.mWeightedStrength), Ops::Sub(weight, Ops::Set(1.0f)))));
+
+            px = Ops::Mul(px, Ops::Set(noise.mLacunarity));
+            py = Ops::Mul(py, Ops::Set(noise.mLacunarity));
+            amp = Ops::Mul(amp, Ops::Set(noise.mGain));
+        }
+
+        Ops::Store(output + done, sum);
+    }
+
+    return done;
+}
@@ -0,0 +1,286 @@
+#include "occlusion.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+// Shader storage bindings shared with occlusionCull.comp
+enum OcclusionBinding
+{
+    OCCLUSION_ITEMS = 0,
+    OCCLUSION_CANDIDATES = 1,
+    OCCLUSION_VISIBLE = 2,
+    OCCLUSION_COUNTERS = 3,
+    OCCLUSION_MODEL_BASES = 4,
+    OCCLUSION_COMMANDS = 5,
+    OCCLUSION_COMMAND_MODELS = 6,
+    OCCLUSION_VISIBLE_ITEMS = 8      // 7 is GPU_SCENE_DRAW_DATA_BINDING
+};
+
+static GLuint CreateBuffer(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    glBufferData(target, std::max<GLsizeiptr>(size, 4), data, usage);
+    glBindBuffer(target, 0);
+    return buffer;
+}
+
+static GLuint GroupCount(int items, GLuint groupSize)
+{
+    return ((GLuint)items + groupSize - 1) / groupSize;
+}
+
+bool InitialiseOcclusionCuller(OcclusionCuller& culler, const GpuScene& scene,
+    const std::vector<InstancedModel>& models, int framebufferWidth, int framebufferHeight)
+{
+    culler = OcclusionCuller();
+
+    if (!scene.enabled)
+        return false;
+
+    ShaderInfo depthShaders[] = {
+        { GL_VERTEX_SHADER, "shaders/occlusionDepth.vert", 0 },
+        { GL_FRAGMENT_SHADER, "shaders/occlusionDepth.frag", 0 },
+        { GL_NONE, NULL, 0 }
+    };
+    ShaderInfo downsampleShaders[] = {
+        { GL_COMPUTE_SHADER, "shaders/hizDownsample.comp", 0 },
+        { GL_NONE, NULL, 0 }
+    };
+    ShaderInfo cullShaders[] = {
+        { GL_COMPUTE_SHADER, "shaders/occlusionCull.comp", 0 },
+        { GL_NONE, NULL, 0 }
+    };
+
+    bool built = LoadShaderProgram(culler.depthProgram, depthShaders);
+    built = LoadShaderProgram(culler.downsampleProgram, downsampleShaders) && built;
+    built = LoadShaderProgram(culler.cullProgram, cullShaders) && built;
+
+    if (!built)
+    {
+        std::cout << "Occlusion culling shaders failed to build - drawing everything in the frustum\n";
+        CleanupOcclusionCuller(culler);
+        return false;
+    }
+
+    // Hi-Z target: a depth texture for the occluder pass and an R32F mip chain
+    culler.width = std::max(framebufferWidth / OCCLUSION_HIZ_DOWNSCALE, 1);
+    culler.height = std::max(framebufferHeight / OCCLUSION_HIZ_DOWNSCALE, 1);
+    culler.levels = 1;
+    while ((std::max(culler.width, culler.height) >> culler.levels) > 0)
+        culler.levels++;
+
+    glGenTextures(1, &culler.depthTexture);
+    glBindTexture(GL_TEXTURE_2D, culler.depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, culler.width, culler.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &culler.hizTexture);
+    glBindTexture(GL_TEXTURE_2D, culler.hizTexture);
+    glTexStorage2D(GL_TEXTURE_2D, culler.levels, GL_R32F, culler.width, culler.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &culler.depthFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, culler.depthFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, culler.depthTexture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!complete)
+    {
+        std::cout << "Occlusion depth target is incomplete - drawing everything in the frustum\n";
+        CleanupOcclusionCuller(culler);
+        return false;
+    }
+
+    std::vector<GLuint> modelBases(scene.modelBase.begin(), scene.modelBase.end());
+
+    culler.itemBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, scene.itemCount * sizeof(OcclusionItem), nullptr, GL_DYNAMIC_DRAW);
+    culler.candidateBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, scene.itemCount * sizeof(GLuint), nullptr, GL_STREAM_DRAW);
+    culler.counterBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, modelBases.size() * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+    culler.modelBaseBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, modelBases.size() * sizeof(GLuint), modelBases.data(), GL_STATIC_DRAW);
+    culler.visibleItemBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, scene.itemCount * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+    UpdateOcclusionItems(culler, models);
+
+    // Samplers stay on unit 0 and the sizes only change with a rebuild
+    culler.firstLevel = FindUniform(culler.downsampleProgram, "firstLevel");
+    culler.candidateCount = FindUniform(culler.cullProgram, "candidateCount");
+    culler.cullStage = FindUniform(culler.cullProgram, "cullStage");
+
+    UseShaderProgram(culler.downsampleProgram);
+    SetUniform(culler.downsampleProgram, FindUniform(culler.downsampleProgram, "depthIn"), 0);
+
+    UseShaderProgram(culler.cullProgram);
+    SetUniform(culler.cullProgram, FindUniform(culler.cullProgram, "hiz"), 0);
+    SetUniform(culler.cullProgram, FindUniform(culler.cullProgram, "hizLevels"), culler.levels);
+    SetUniform(culler.cullProgram, FindUniform(culler.cullProgram, "commandCount"), (GLuint)scene.commands.size());
+    glUseProgram(0);
+
+    culler.candidates.reserve(scene.itemCount);
+    culler.enabled = true;
+    return true;
+}
+
+void UpdateOcclusionItems(OcclusionCuller& culler, const std::vector<InstancedModel>& models)
+{
+    std::vector<OcclusionItem> items;
+
+    for (int model = 0; model < (int)models.size(); model++)
+    {
+        for (const InstanceTransform* placement : models[model].placements)
+        {
+            OcclusionItem item = {};
+            item.world = placement->world;
+            item.boundsMin = glm::vec4(placement->boundsMin, 1.0f);
+            item.boundsMax = glm::vec4(placement->boundsMax, 1.0f);
+            item.model = (GLuint)model;
+            items.push_back(item);
+        }
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, culler.itemBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, items.size() * sizeof(OcclusionItem), items.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Step 1: last frame's visible placements, depth only, from this frame's camera.
+// The commands and visible item list are last frame's, but each instance looks
+// its matrix up in the item buffer, which UpdateOcclusionItems already refreshed.
+static void DrawOccluders(OcclusionCuller& culler, const GpuScene& scene)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, culler.depthFBO);
+    glViewport(0, 0, culler.width, culler.height);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    if (!culler.hasHistory)
+        return;
+
+    UseShaderProgram(culler.depthProgram);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_ITEMS, culler.itemBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_VISIBLE_ITEMS, culler.visibleItemBuffer);
+
+    glBindVertexArray(scene.VAO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, scene.commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, (GLsizei)scene.commands.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+// Step 2: depth -> level 0, then each level from the one above
+static void BuildHiZ(OcclusionCuller& culler)
+{
+    UseShaderProgram(culler.downsampleProgram);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, culler.depthTexture);
+
+    for (int level = 0; level < culler.levels; level++)
+    {
+        int levelWidth = std::max(culler.width >> level, 1);
+        int levelHeight = std::max(culler.height >> level, 1);
+
+        SetUniform(culler.downsampleProgram, culler.firstLevel, level == 0 ? 1 : 0);
+        glBindImageTexture(0, culler.hizTexture, std::max(level - 1, 0), GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, culler.hizTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        glDispatchCompute(GroupCount(levelWidth, OCCLUSION_HIZ_GROUP), GroupCount(levelHeight, OCCLUSION_HIZ_GROUP), 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+// Step 3: test candidates, then copy each model's count into its commands
+static void CullCandidates(OcclusionCuller& culler, const GpuScene& scene)
+{
+    GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, culler.counterBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, culler.candidateBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, culler.candidates.size() * sizeof(GLuint), culler.candidates.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_ITEMS, culler.itemBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_CANDIDATES, culler.candidateBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_VISIBLE, scene.instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_COUNTERS, culler.counterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_MODEL_BASES, culler.modelBaseBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_COMMANDS, scene.commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_COMMAND_MODELS, scene.commandModelBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_VISIBLE_ITEMS, culler.visibleItemBuffer);
+
+    const ShaderProgram& program = culler.cullProgram;
+    UseShaderProgram(program);
+    SetUniform(program, culler.candidateCount, (GLuint)culler.candidates.size());
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, culler.hizTexture);
+
+    SetUniform(program, culler.cullStage, 0);
+    if (!culler.candidates.empty())
+        glDispatchCompute(GroupCount((int)culler.candidates.size(), OCCLUSION_CULL_GROUP), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    SetUniform(program, culler.cullStage, 1);
+    glDispatchCompute(GroupCount((int)scene.commands.size(), OCCLUSION_CULL_GROUP), 1, 1);
+
+    // Commands are read by the draws, matrices as instance attributes
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void CullOcclusion(OcclusionCuller& culler, const GpuScene& scene, const std::vector<BvhItem>& frustumVisible)
+{
+    if (!culler.enabled || scene.commands.empty())
+        return;
+
+    culler.candidates.clear();
+    for (const BvhItem& item : frustumVisible)
+        culler.candidates.push_back((GLuint)(scene.modelBase[item.model] + item.placement));
+
+    GLint viewport[4];
+    GLint framebuffer = 0;
+    GLint program = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+
+    DrawOccluders(culler, scene);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    BuildHiZ(culler);
+    CullCandidates(culler, scene);
+
+    glUseProgram((GLuint)program);
+    culler.hasHistory = true;
+}
+
+void CleanupOcclusionCuller(OcclusionCuller& culler)
+{
+    GLuint buffers[] = { culler.itemBuffer, culler.candidateBuffer, culler.counterBuffer, culler.modelBaseBuffer,
+        culler.visibleItemBuffer };
+    glDeleteBuffers(sizeof(buffers) / sizeof(buffers[0]), buffers);
+
+    GLuint textures[] = { culler.depthTexture, culler.hizTexture };
+    glDeleteTextures(2, textures);
+    glDeleteFramebuffers(1, &culler.depthFBO);
+
+    CleanupShaderProgram(culler.depthProgram);
+    CleanupShaderProgram(culler.downsampleProgram);
+    CleanupShaderProgram(culler.cullProgram);
+
+    culler = OcclusionCuller();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "bvh.h"
+#include "gpuscene.h"
+#include "instancing.h"
+#include "shaderprogram.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// HI-Z OCCLUSION CULLING
+//
+// Each frame:
+//   1. Whatever was visible last frame is drawn depth-only, from this frame's
+//      camera and with this frame's transforms, into a small depth buffer -
+//      last frame's visible set is what can hide things this frame.
+//   2. A compute pass turns it into a max-depth mip chain (the Hi-Z pyramid).
+//   3. A compute pass tests each frustum-visible placement's box against the
+//      pyramid level where the box covers 2x2 texels, appends the world
+//      matrices of survivors to the GpuScene instance buffer (and their item
+//      indices to a matching list, for step 1 next frame) and writes the
+//      instance counts into its indirect commands, so the visible counts never
+//      come back to the CPU.
+//
+// Placements hidden last frame that now hide others are missing from step 1,
+// which only lets extra things through - nothing visible is ever dropped,
+// short of gaps narrower than one Hi-Z texel.
+//
+// Drives a GpuScene (gpuscene.h), in place of UpdateGpuSceneInstances.
+// -----------------------------------------------------------------------------
+constexpr int OCCLUSION_HIZ_DOWNSCALE = 4;     // Hi-Z size = framebuffer / this
+constexpr GLuint OCCLUSION_CULL_GROUP = 64;    // local_size_x in occlusionCull.comp
+constexpr GLuint OCCLUSION_HIZ_GROUP = 8;      // local_size_x/y in hizDownsample.comp
+
+// One placement as the cull shader sees it (std430)
+struct OcclusionItem
+{
+    glm::mat4 world;
+    glm::vec4 boundsMin;
+    glm::vec4 boundsMax;
+    GLuint model;
+    GLuint padding[3];
+};
+
+struct OcclusionCuller
+{
+    bool enabled = false;
+
+    int width = 0;                 // Hi-Z level 0
+    int height = 0;
+    int levels = 0;
+
+    GLuint depthFBO = 0;
+    GLuint depthTexture = 0;       // occluder pass target
+    GLuint hizTexture = 0;         // R32F mip chain
+
+    ShaderProgram depthProgram;    // occlusionDepth.vert/.frag
+    ShaderProgram downsampleProgram;
+    ShaderProgram cullProgram;
+
+    // The uniforms that change per dispatch - the rest are set once
+    UniformHandle firstLevel = UNIFORM_NONE;       // hizDownsample.comp
+    UniformHandle candidateCount = UNIFORM_NONE;   // occlusionCull.comp
+    UniformHandle cullStage = UNIFORM_NONE;
+
+    GLuint itemBuffer = 0;         // OcclusionItem per placement, GpuScene slot order
+    GLuint candidateBuffer = 0;    // item indices that passed the frustum test
+    GLuint counterBuffer = 0;      // visible count per model
+    GLuint modelBaseBuffer = 0;    // GpuScene::modelBase
+    GLuint visibleItemBuffer = 0;  // item index behind each instance buffer matrix
+
+    std::vector<GLuint> candidates;
+    bool hasHistory = false;       // the scene's commands hold a previous frame's result
+};
+
+// Builds the Hi-Z target, programs and buffers for an initialised GpuScene.
+// Returns false if the scene is not enabled or a shader fails - the scene can
+// still be drawn with UpdateGpuSceneInstances then.
+bool InitialiseOcclusionCuller(OcclusionCuller& culler, const GpuScene& scene,
+    const std::vector<InstancedModel>& models, int framebufferWidth, int framebufferHeight);
+
+// Re-uploads every placement - after any of them were refreshed
+void UpdateOcclusionItems(OcclusionCuller& culler, const std::vector<InstancedModel>& models);
+
+// Steps 1-3 above, for the placements the BVH found inside the frustum, from
+// the camera in the Camera block (camera.h) - update that first.
+// Leaves the draw framebuffer, viewport and program as they were.
+void CullOcclusion(OcclusionCuller& culler, const GpuScene& scene, const std::vector<BvhItem>& frustumVisible);
+
+void CleanupOcclusionCuller(OcclusionCuller& culler);
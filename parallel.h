@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// PARALLEL FOR
+//
+// Splits [begin, end) into one contiguous block per thread and calls
+// fn(first, last) on each. Blocks never overlap, so writing results by index
+// gives the same output whatever the thread count.
+//
+// threadCount: 0 = one per core, 1 = run inline on the calling thread.
+// -----------------------------------------------------------------------------
+inline int ResolveThreadCount(int requested)
+{
+    if (requested > 0)
+        return requested;
+
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 0 ? (int)cores : 1;
+}
+
+template <typename Fn>
+void ParallelFor(int begin, int end, int threadCount, Fn fn)
+{
+    int count = end - begin;
+    if (count <= 0)
+        return;
+
+    int threads = std::min(ResolveThreadCount(threadCount), count);
+    if (threads == 1)
+    {
+        fn(begin, end);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+
+    int blockSize = count / threads;
+    int remainder = count % threads;
+    int first = begin;
+
+    for (int t = 0; t < threads; t++)
+    {
+        int last = first + blockSize + (t < remainder ? 1 : 0);
+
+        // Calling thread takes the last block itself
+        if (t == threads - 1)
+            fn(first, last);
+        else
+            workers.emplace_back(fn, first, last);
+
+        first = last;
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
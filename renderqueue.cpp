@@ -0,0 +1,191 @@
+#include "renderqueue.h"
+
+#include <algorithm>
+#include <string>
+
+// The texture types Mesh::Draw numbers, in sampler slot order
+static const char* const RENDER_SAMPLER_TYPE_NAMES[RENDER_SAMPLER_TYPES] = {
+    "texture_diffuse", "texture_specular", "texture_normal", "texture_height"
+};
+
+// Registers a program the first time it is queued, resolving every sampler
+// slot's handle then so binding a material never looks a name up
+static uint64_t ProgramRank(RenderQueue& queue, const ShaderProgram& shader)
+{
+    for (size_t i = 0; i < queue.programs.size(); i++)
+    {
+        if (queue.programs[i] == shader.ID)
+            return i;
+    }
+
+    RenderProgramSamplers samplers;
+    for (int slot = 0; slot < RENDER_SAMPLER_SLOTS; slot++)
+    {
+        std::string name = RENDER_SAMPLER_TYPE_NAMES[slot / RENDER_SAMPLERS_PER_TYPE]
+            + std::to_string(slot % RENDER_SAMPLERS_PER_TYPE + 1);
+        samplers.handles[slot] = FindUniform(shader, name);
+        samplers.units[slot] = -1;
+    }
+
+    queue.programs.push_back(shader.ID);
+    queue.programSamplers.push_back(samplers);
+    return queue.programs.size() - 1;
+}
+
+int RenderMaterialId(RenderQueue& queue, const RenderMaterial& material)
+{
+    auto found = queue.materialIds.find(material);
+    if (found != queue.materialIds.end())
+        return found->second;
+
+    int id = (int)queue.materials.size();
+    queue.materials.push_back(material);
+    queue.materialIds[material] = id;
+    return id;
+}
+
+static int MeshMaterialId(RenderQueue& queue, const Mesh& mesh)
+{
+    auto found = queue.meshMaterials.find(&mesh);
+    if (found != queue.meshMaterials.end())
+        return found->second;
+
+    // Numbered per type in mesh order, as Mesh::Draw does
+    int numbers[RENDER_SAMPLER_TYPES] = {};
+
+    RenderMaterial material;
+    for (const Texture& texture : mesh.textures)
+    {
+        int slot = RENDER_SAMPLER_NONE;
+        for (int type = 0; type < RENDER_SAMPLER_TYPES; type++)
+        {
+            if (texture.type == RENDER_SAMPLER_TYPE_NAMES[type])
+            {
+                int number = numbers[type]++;
+                if (number < RENDER_SAMPLERS_PER_TYPE)
+                    slot = type * RENDER_SAMPLERS_PER_TYPE + number;
+                break;
+            }
+        }
+
+        material.textures.push_back(std::make_pair(slot, texture.id));
+    }
+
+    int id = RenderMaterialId(queue, material);
+    queue.meshMaterials[&mesh] = id;
+    return id;
+}
+
+void QueueDraw(RenderQueue& queue, DrawPacket packet)
+{
+    if (packet.shader == nullptr || packet.indexCount == 0 || packet.instanceCount == 0)
+        return;
+
+    packet.key = (ProgramRank(queue, *packet.shader) << RENDER_KEY_PROGRAM_SHIFT)
+        | (((uint64_t)packet.material & RENDER_KEY_FIELD_MASK) << RENDER_KEY_MATERIAL_SHIFT)
+        | ((uint64_t)packet.VAO & RENDER_KEY_FIELD_MASK);
+
+    queue.packets.push_back(packet);
+}
+
+void QueueInstancedModel(RenderQueue& queue, const InstancedModel& instanced, const ShaderProgram& shader)
+{
+    if (instanced.model == nullptr || instanced.instanceCount == 0)
+        return;
+
+    for (const Mesh& mesh : instanced.model->meshes)
+    {
+        DrawPacket packet;
+        packet.shader = &shader;
+        packet.material = MeshMaterialId(queue, mesh);
+        packet.VAO = mesh.VAO;
+        packet.indexCount = (GLsizei)mesh.indices.size();
+        packet.instanceCount = instanced.instanceCount;
+
+        QueueDraw(queue, packet);
+    }
+}
+
+static void BindMaterial(RenderQueue& queue, const ShaderProgram& shader, RenderProgramSamplers& samplers,
+    const RenderMaterial& material)
+{
+    if (queue.boundTextures.size() < material.textures.size())
+        queue.boundTextures.resize(material.textures.size(), 0);
+
+    for (size_t unit = 0; unit < material.textures.size(); unit++)
+    {
+        int slot = material.textures[unit].first;
+        GLuint texture = material.textures[unit].second;
+
+        // Sampler uniforms are program state, so they only change when a
+        // program sees a texture set laid out differently from the last one
+        if (slot != RENDER_SAMPLER_NONE && samplers.units[slot] != (GLint)unit)
+        {
+            SetUniform(shader, samplers.handles[slot], (int)unit);
+            samplers.units[slot] = (GLint)unit;
+            queue.stats.samplerUniforms++;
+        }
+
+        if (queue.boundTextures[unit] != texture)
+        {
+            glActiveTexture(GL_TEXTURE0 + (GLenum)unit);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            queue.boundTextures[unit] = texture;
+            queue.stats.textureBinds++;
+        }
+    }
+}
+
+void SubmitRenderQueue(RenderQueue& queue)
+{
+    queue.stats = RenderQueueStats();
+    queue.stats.packets = (int)queue.packets.size();
+
+    if (queue.packets.empty())
+        return;
+
+    std::sort(queue.packets.begin(), queue.packets.end(),
+        [](const DrawPacket& a, const DrawPacket& b) { return a.key < b.key; });
+
+    queue.boundProgram = 0;
+    queue.boundVAO = 0;
+    std::fill(queue.boundTextures.begin(), queue.boundTextures.end(), 0);
+
+    int boundMaterial = -1;
+
+    for (const DrawPacket& packet : queue.packets)
+    {
+        GLuint program = packet.shader->ID;
+        if (program != queue.boundProgram)
+        {
+            glUseProgram(program);
+            queue.boundProgram = program;
+            boundMaterial = -1;
+            queue.stats.programBinds++;
+        }
+
+        if (packet.material != boundMaterial)
+        {
+            RenderProgramSamplers& samplers = queue.programSamplers[packet.key >> RENDER_KEY_PROGRAM_SHIFT];
+            BindMaterial(queue, *packet.shader, samplers, queue.materials[packet.material]);
+            boundMaterial = packet.material;
+        }
+
+        if (packet.VAO != queue.boundVAO)
+        {
+            glBindVertexArray(packet.VAO);
+            queue.boundVAO = packet.VAO;
+            queue.stats.vaoBinds++;
+        }
+
+        glDrawElementsInstanced(packet.mode, packet.indexCount, GL_UNSIGNED_INT, 0, packet.instanceCount);
+        queue.stats.draws++;
+    }
+
+    // Leave the defaults the rest of the frame expects
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+    queue.boundVAO = 0;
+
+    queue.packets.clear();
+}
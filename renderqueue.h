@@ -0,0 +1,113 @@
+#pragma once
+
+#include "instancing.h"
+#include "shaderprogram.h"
+
+#include <glad/glad.h>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/model.h>
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// RENDER QUEUE
+//
+// Draws are collected as packets during the frame and sorted by a 64-bit key
+// before any GL call is made, so each program, texture set and VAO is bound
+// once per run of packets that share it instead of once per draw:
+//
+//   bits 63-48  program     (rank in the order programs were first queued)
+//   bits 47-24  material    (texture set, shared by every mesh that uses it)
+//   bits 23-0   VAO
+//
+// Submit also remembers what it last bound - texture units, sampler uniforms,
+// program and VAO - and skips any bind that would not change anything.
+// -----------------------------------------------------------------------------
+constexpr int RENDER_KEY_PROGRAM_SHIFT = 48;
+constexpr int RENDER_KEY_MATERIAL_SHIFT = 24;
+constexpr uint64_t RENDER_KEY_FIELD_MASK = 0xFFFFFF;
+
+// Sampler uniforms are named the way Mesh::Draw names them - texture_diffuse1,
+// texture_specular1, ... - and stored as a slot: type * RENDER_SAMPLERS_PER_TYPE
+// + number - 1. Textures of another type or numbered past the last slot are
+// bound but get no sampler (RENDER_SAMPLER_NONE).
+constexpr int RENDER_SAMPLER_TYPES = 4;        // diffuse, specular, normal, height
+constexpr int RENDER_SAMPLERS_PER_TYPE = 4;
+constexpr int RENDER_SAMPLER_SLOTS = RENDER_SAMPLER_TYPES * RENDER_SAMPLERS_PER_TYPE;
+constexpr int RENDER_SAMPLER_NONE = -1;
+
+// Textures and the sampler slots they go to, in texture unit order
+struct RenderMaterial
+{
+    std::vector<std::pair<int, GLuint>> textures;
+
+    bool operator<(const RenderMaterial& other) const { return textures < other.textures; }
+};
+
+struct DrawPacket
+{
+    uint64_t key = 0;
+
+    const ShaderProgram* shader = nullptr;
+    int material = 0;              // into RenderQueue::materials
+    GLuint VAO = 0;
+
+    GLenum mode = GL_TRIANGLES;
+    GLsizei indexCount = 0;        // GL_UNSIGNED_INT indices from offset 0
+    GLsizei instanceCount = 1;
+};
+
+// A program's sampler handles, resolved when the queue first sees it, and the
+// unit each was last set to
+struct RenderProgramSamplers
+{
+    UniformHandle handles[RENDER_SAMPLER_SLOTS];
+    GLint units[RENDER_SAMPLER_SLOTS];
+};
+
+// Per-submit counts - binds are the ones actually issued, after skipping
+struct RenderQueueStats
+{
+    int packets = 0;
+    int draws = 0;
+    int programBinds = 0;
+    int textureBinds = 0;
+    int samplerUniforms = 0;
+    int vaoBinds = 0;
+};
+
+struct RenderQueue
+{
+    std::vector<DrawPacket> packets;
+
+    std::vector<RenderMaterial> materials;
+    std::map<RenderMaterial, int> materialIds;
+    std::unordered_map<const Mesh*, int> meshMaterials;   // so meshes are only looked at once
+    std::vector<GLuint> programs;                          // index = key rank
+    std::vector<RenderProgramSamplers> programSamplers;    // index = key rank
+
+    // What the last Submit left bound
+    GLuint boundProgram = 0;
+    GLuint boundVAO = 0;
+    std::vector<GLuint> boundTextures;                     // per texture unit
+
+    RenderQueueStats stats;
+};
+
+// Material id for the texture set, registering it the first time it is seen
+int RenderMaterialId(RenderQueue& queue, const RenderMaterial& material);
+
+// One instanced packet per mesh of the model
+void QueueInstancedModel(RenderQueue& queue, const InstancedModel& instanced, const ShaderProgram& shader);
+
+void QueueDraw(RenderQueue& queue, DrawPacket packet);
+
+// Sorts and draws everything queued, then empties the queue. The bound
+// program, VAO and textures are forgotten at the start, since other code may
+// have drawn in between; sampler values are kept, so only the queue should set
+// those uniforms. Per-frame uniforms (camera etc.) must already be set.
+void SubmitRenderQueue(RenderQueue& queue);
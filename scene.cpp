@@ -0,0 +1,335 @@
+#include "scene.h"
+#include "assetfile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// -----------------------------------------------------------------------------
+// BINARY LAYOUT (little-endian)
+//
+// char[4] "SCNB", uint32 version
+// uint64 sourceSize, uint64 sourceHash     (SceneSource of the text it was built from)
+// float anchor[3]
+// uint32 modelCount, uint32 instanceCount
+// modelCount    x { uint32 pathLength, char path[pathLength], uint32 firstInstance, uint32 instanceCount }
+// instanceCount x { float position[3], float rotationY, float scale[3] }    (OpenGL space)
+// -----------------------------------------------------------------------------
+static const char SCENE_BINARY_MAGIC[4] = { 'S', 'C', 'N', 'B' };
+static const uint32_t SCENE_BINARY_VERSION = 2;
+
+// Converts Blender world coordinates to OpenGL world coordinates
+// Blender: X = left/right, Y = forward, Z = up
+// OpenGL:  X = left/right, Y = up,      Z = -forward
+static glm::vec3 BlenderToOpenGL(float bx, float by, float bz)
+{
+    return glm::vec3(
+        bx,     // X stays X
+        bz,     // Blender Z (up) -> OpenGL Y (up)
+        -by     // Blender Y (forward) -> OpenGL -Z (forward)
+    );
+}
+
+// cave.scene -> cave.sceneb
+static std::string BinaryCachePath(const std::string& path)
+{
+    return path + "b";
+}
+
+bool GetSceneSource(const std::string& path, SceneSource& source)
+{
+    AssetFile file;
+    if (!OpenAssetFile(path, file))
+        return false;
+
+    source.size = file.size;
+    source.hash = 14695981039346656037ull;
+    for (size_t i = 0; i < file.size; i++)
+    {
+        source.hash ^= file.data[i];
+        source.hash *= 1099511628211ull;
+    }
+
+    CloseAssetFile(file);
+    return true;
+}
+
+bool LoadScene(const std::string& path, Scene& scene)
+{
+    // Hashing the text is far cheaper than parsing it, and unlike a file time
+    // it catches an edit made in the same second the cache was written
+    std::string cache = BinaryCachePath(path);
+    SceneSource source;
+    bool hasSource = GetSceneSource(path, source);
+
+    if (hasSource && LoadSceneBinary(cache, scene, source))
+        return true;
+
+    if (!LoadSceneText(path, scene))
+        return false;
+
+    // Without a cache the next start just parses the text again, so this can fail quietly
+    if (hasSource)
+        SaveSceneBinary(cache, scene, source);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// TEXT
+// -----------------------------------------------------------------------------
+bool LoadSceneText(const std::string& path, Scene& scene)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "Scene '" << path << "' could not be opened\n";
+        return false;
+    }
+
+    // Placements per model, in order of first appearance - a model listed twice is merged
+    std::vector<std::string> order;
+    std::map<std::string, std::vector<InstanceTransform>> placements;
+
+    glm::vec3 anchor(0.0f);
+    glm::vec3 defaultScale(1.0f);
+    std::string current;
+
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream in(line);
+        std::string keyword;
+        if (!(in >> keyword))
+            continue;
+
+        bool ok = true;
+
+        if (keyword == "anchor")
+        {
+            ok = (bool)(in >> anchor.x >> anchor.y >> anchor.z);
+        }
+        else if (keyword == "scale")
+        {
+            float scale;
+            ok = (bool)(in >> scale);
+            defaultScale = glm::vec3(scale);
+        }
+        else if (keyword == "model")
+        {
+            // The rest of the line, so paths can contain spaces
+            std::getline(in >> std::ws, current);
+            current.erase(current.find_last_not_of(" \t") + 1);
+
+            ok = !current.empty();
+            if (ok && placements.find(current) == placements.end())
+            {
+                order.push_back(current);
+                placements[current];
+            }
+        }
+        else if (keyword == "instance")
+        {
+            float bx = 0.0f, by = 0.0f, bz = 0.0f;
+            InstanceTransform instance;
+
+            ok = !current.empty() && (bool)(in >> bx >> by >> bz >> instance.rotationY);
+            instance.position = BlenderToOpenGL(bx, by, bz);
+            instance.scale = defaultScale;
+
+            // Optional scale: one value for uniform, three for per-axis
+            float scale[3];
+            int scaleCount = 0;
+            while (ok && scaleCount < 3 && in >> scale[scaleCount])
+                scaleCount++;
+
+            if (scaleCount == 1)
+                instance.scale = glm::vec3(scale[0]);
+            else if (scaleCount == 3)
+                instance.scale = glm::vec3(scale[0], scale[1], scale[2]);
+            else if (scaleCount != 0 || (in.fail() && !in.eof()))
+                ok = false;
+
+            if (ok)
+                placements[current].push_back(instance);
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            std::cout << "Scene '" << path << "' line " << lineNumber << ": could not read \"" << line << "\"\n";
+            return false;
+        }
+    }
+
+    scene = Scene();
+    scene.anchor = anchor;
+
+    for (const std::string& modelPath : order)
+    {
+        const std::vector<InstanceTransform>& instances = placements[modelPath];
+
+        SceneModel model;
+        model.path = modelPath;
+        model.firstInstance = (int)scene.instances.size();
+        model.instanceCount = (int)instances.size();
+
+        scene.models.push_back(model);
+        scene.instances.insert(scene.instances.end(), instances.begin(), instances.end());
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// BINARY
+// -----------------------------------------------------------------------------
+template <typename T>
+static void WriteValue(std::ofstream& out, const T& value)
+{
+    out.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+static bool ReadValue(std::ifstream& in, T& value)
+{
+    return (bool)in.read((char*)&value, sizeof(T));
+}
+
+static void WriteVec3(std::ofstream& out, const glm::vec3& value)
+{
+    WriteValue(out, value.x);
+    WriteValue(out, value.y);
+    WriteValue(out, value.z);
+}
+
+static bool ReadVec3(std::ifstream& in, glm::vec3& value)
+{
+    return ReadValue(in, value.x) && ReadValue(in, value.y) && ReadValue(in, value.z);
+}
+
+bool SaveSceneBinary(const std::string& path, const Scene& scene, const SceneSource& source)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    out.write(SCENE_BINARY_MAGIC, sizeof(SCENE_BINARY_MAGIC));
+    WriteValue(out, SCENE_BINARY_VERSION);
+    WriteValue(out, source.size);
+    WriteValue(out, source.hash);
+    WriteVec3(out, scene.anchor);
+    WriteValue(out, (uint32_t)scene.models.size());
+    WriteValue(out, (uint32_t)scene.instances.size());
+
+    for (const SceneModel& model : scene.models)
+    {
+        WriteValue(out, (uint32_t)model.path.size());
+        out.write(model.path.data(), model.path.size());
+        WriteValue(out, (uint32_t)model.firstInstance);
+        WriteValue(out, (uint32_t)model.instanceCount);
+    }
+
+    for (const InstanceTransform& instance : scene.instances)
+    {
+        WriteVec3(out, instance.position);
+        WriteValue(out, instance.rotationY);
+        WriteVec3(out, instance.scale);
+    }
+
+    return (bool)out;
+}
+
+bool LoadSceneBinary(const std::string& path, Scene& scene, const SceneSource& source)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+
+    char magic[4];
+    uint32_t version = 0;
+    SceneSource built;
+    uint32_t modelCount = 0;
+    uint32_t instanceCount = 0;
+    Scene loaded;
+
+    bool ok = (bool)in.read(magic, sizeof(magic))
+        && std::equal(magic, magic + 4, SCENE_BINARY_MAGIC)
+        && ReadValue(in, version) && version == SCENE_BINARY_VERSION
+        && ReadValue(in, built.size) && ReadValue(in, built.hash);
+
+    // Out of date rather than damaged - rebuilt without a message
+    if (ok && (built.size != source.size || built.hash != source.hash))
+        return false;
+
+    ok = ok && ReadVec3(in, loaded.anchor)
+        && ReadValue(in, modelCount)
+        && ReadValue(in, instanceCount);
+
+    for (uint32_t i = 0; ok && i < modelCount; i++)
+    {
+        uint32_t pathLength = 0;
+        uint32_t first = 0;
+        uint32_t count = 0;
+
+        ok = ReadValue(in, pathLength) && pathLength < 4096;
+        if (!ok)
+            break;
+
+        SceneModel model;
+        model.path.resize(pathLength);
+        ok = (bool)in.read(&model.path[0], pathLength)
+            && ReadValue(in, first)
+            && ReadValue(in, count)
+            && (uint64_t)first + count <= instanceCount;
+
+        model.firstInstance = (int)first;
+        model.instanceCount = (int)count;
+        loaded.models.push_back(model);
+    }
+
+    if (ok)
+        loaded.instances.resize(instanceCount);
+
+    for (uint32_t i = 0; ok && i < instanceCount; i++)
+    {
+        InstanceTransform& instance = loaded.instances[i];
+        ok = ReadVec3(in, instance.position) && ReadValue(in, instance.rotationY) && ReadVec3(in, instance.scale);
+    }
+
+    if (!ok)
+    {
+        std::cout << "Scene cache '" << path << "' is damaged or from another version - rebuilding\n";
+        return false;
+    }
+
+    scene = loaded;
+    return true;
+}
+
+std::vector<InstanceTransform*> ScenePlacements(Scene& scene, const SceneModel& model)
+{
+    std::vector<InstanceTransform*> placements;
+    placements.reserve(model.instanceCount);
+
+    for (int i = 0; i < model.instanceCount; i++)
+        placements.push_back(&scene.instances[model.firstInstance + i]);
+
+    return placements;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "instancing.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// SCENE FILES
+//
+// A level layout: which models to load and where each copy goes. Edited as
+// text (media/scene/*.scene, format described at the top of each file) and
+// cached as a binary copy alongside it, which LoadScene uses for as long as
+// the text still has the size and content hash recorded in it.
+//
+// Placements are grouped by model into one contiguous array and are already
+// in OpenGL space, so they can go straight into InitialiseInstancedModel.
+// -----------------------------------------------------------------------------
+struct SceneModel
+{
+    std::string path;
+    int firstInstance = 0;     // into Scene::instances
+    int instanceCount = 0;
+};
+
+struct Scene
+{
+    glm::vec3 anchor = glm::vec3(0.0f);    // added to every placement
+    std::vector<SceneModel> models;
+    std::vector<InstanceTransform> instances;
+};
+
+// Which text a binary cache was built from
+struct SceneSource
+{
+    uint64_t size = 0;
+    uint64_t hash = 0;         // FNV-1a over the text's bytes
+};
+
+// Loads path (text), going through the binary cache beside it when that is up
+// to date and rewriting the cache when it is not. Prints why on failure.
+bool LoadScene(const std::string& path, Scene& scene);
+
+bool LoadSceneText(const std::string& path, Scene& scene);
+
+// False if the text cannot be opened
+bool GetSceneSource(const std::string& path, SceneSource& source);
+
+// LoadSceneBinary fails if the cache was built from any other source
+bool LoadSceneBinary(const std::string& path, Scene& scene, const SceneSource& source);
+bool SaveSceneBinary(const std::string& path, const Scene& scene, const SceneSource& source);
+
+// Pointers to one model's placements, for InitialiseInstancedModel.
+// They point into scene.instances, so the scene must outlive their users.
+std::vector<InstanceTransform*> ScenePlacements(Scene& scene, const SceneModel& model);
@@ -0,0 +1,314 @@
+#include "shaderprogram.h"
+#include "assetfile.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// PROGRAM BINARY CACHE (little-endian)
+//
+// char[4] "PGBN", uint32 version
+// uint64 key           (sources + driver strings, see ProgramKey)
+// uint32 binaryFormat  (as returned by glGetProgramBinary)
+// uint32 binaryLength, char binary[binaryLength]
+// -----------------------------------------------------------------------------
+static const char PROGRAM_BINARY_MAGIC[4] = { 'P', 'G', 'B', 'N' };
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+// FNV-1a
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static const uint64_t HASH_SEED = 14695981039346656037ull;
+
+static uint64_t HashString(uint64_t hash, const std::string& value)
+{
+    uint32_t length = (uint32_t)value.size();
+
+    // Length first, so ("ab", "c") and ("a", "bc") differ
+    hash = HashBytes(hash, &length, sizeof(length));
+    return HashBytes(hash, value.data(), value.size());
+}
+
+static std::string DriverString(GLenum name)
+{
+    const GLubyte* value = glGetString(name);
+    return value != nullptr ? (const char*)value : "";
+}
+
+static bool ProgramBinaryCacheAvailable()
+{
+    if (!GLAD_GL_VERSION_4_1)
+        return false;
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// A binary is only good for the exact sources and the exact driver that made it
+static bool ProgramKey(const ShaderInfo* shaders, uint64_t& key)
+{
+    key = HASH_SEED;
+    key = HashString(key, DriverString(GL_VENDOR));
+    key = HashString(key, DriverString(GL_RENDERER));
+    key = HashString(key, DriverString(GL_VERSION));
+
+    for (const ShaderInfo* entry = shaders; entry->type != GL_NONE; ++entry)
+    {
+        AssetFile source;
+        if (!OpenAssetFile(entry->filename, source))
+            return false;
+
+        uint64_t length = source.size;
+        key = HashBytes(key, &entry->type, sizeof(entry->type));
+        key = HashBytes(key, &length, sizeof(length));
+        key = HashBytes(key, source.data, source.size);
+
+        CloseAssetFile(source);
+    }
+
+    return true;
+}
+
+// Beside the first stage, named by the whole stage list so programs sharing a stage don't collide
+static std::string ProgramCachePath(const ShaderInfo* shaders)
+{
+    uint64_t hash = HASH_SEED;
+    for (const ShaderInfo* entry = shaders; entry->type != GL_NONE; ++entry)
+        hash = HashString(hash, entry->filename);
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%08x.glbin", (unsigned int)(hash ^ (hash >> 32)));
+    return std::string(shaders[0].filename) + suffix;
+}
+
+template <typename T>
+static void WriteValue(std::ofstream& out, const T& value)
+{
+    out.write((const char*)&value, sizeof(T));
+}
+
+// 0 if there is no cached binary, it was made for other sources or another
+// driver, or the driver will not take it back
+static GLuint LoadProgramBinary(const std::string& path, uint64_t key)
+{
+    AssetFile file;
+    if (!OpenAssetFile(path, file))
+        return 0;
+
+    AssetReader in(file);
+    const unsigned char* magic = in.Take(4);
+    uint32_t version = 0;
+    uint64_t storedKey = 0;
+    uint32_t format = 0;
+    uint32_t length = 0;
+    const unsigned char* binary = nullptr;
+
+    bool ok = magic != nullptr && std::equal(magic, magic + 4, PROGRAM_BINARY_MAGIC)
+        && in.Read(version) && version == PROGRAM_BINARY_VERSION
+        && in.Read(storedKey) && storedKey == key
+        && in.Read(format)
+        && in.Read(length) && length > 0
+        && (binary = in.Take(length)) != nullptr;
+
+    if (!ok)
+    {
+        CloseAssetFile(file);
+        return 0;
+    }
+
+    // Straight from the mapping
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, (GLenum)format, binary, (GLsizei)length);
+    CloseAssetFile(file);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+static void SaveProgramBinary(const std::string& path, uint64_t key, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = GL_NONE;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    if (length <= 0)
+        return;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return;
+
+    out.write(PROGRAM_BINARY_MAGIC, 4);
+    WriteValue(out, PROGRAM_BINARY_VERSION);
+    WriteValue(out, key);
+    WriteValue(out, (uint32_t)format);
+    WriteValue(out, (uint32_t)length);
+    out.write(binary.data(), length);
+}
+
+bool LoadShaderProgram(ShaderProgram& program, ShaderInfo* shaders)
+{
+    program = ShaderProgram();
+
+    if (shaders == nullptr || shaders[0].type == GL_NONE)
+        return false;
+
+    std::string cachePath;
+    uint64_t key = 0;
+
+    if (ProgramBinaryCacheAvailable() && ProgramKey(shaders, key))
+    {
+        cachePath = ProgramCachePath(shaders);
+        program.ID = LoadProgramBinary(cachePath, key);
+        program.fromCache = program.ID != 0;
+    }
+
+    if (program.ID == 0)
+    {
+        program.ID = LoadShaders(shaders);
+        if (program.ID == 0)
+            return false;
+
+        if (!cachePath.empty())
+            SaveProgramBinary(cachePath, key, program.ID);
+    }
+
+    ReflectUniforms(program);
+    return true;
+}
+
+bool LoadShaderProgram(ShaderProgram& program, const char* vertexPath, const char* fragmentPath)
+{
+    ShaderInfo shaders[] = {
+        { GL_VERTEX_SHADER, vertexPath, 0 },
+        { GL_FRAGMENT_SHADER, fragmentPath, 0 },
+        { GL_NONE, NULL, 0 }
+    };
+
+    if (!LoadShaderProgram(program, shaders))
+    {
+        std::cout << "Shader program " << vertexPath << " + " << fragmentPath << " failed to build\n";
+        return false;
+    }
+
+    return true;
+}
+
+void ReflectUniforms(ShaderProgram& program)
+{
+    program.uniforms.clear();
+    program.handles.clear();
+
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(program.ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program.ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<GLchar> name(std::max(maxLength, 1));
+
+    for (GLint i = 0; i < count; i++)
+    {
+        ShaderUniform uniform;
+        GLsizei length = 0;
+        glGetActiveUniform(program.ID, (GLuint)i, (GLsizei)name.size(), &length, &uniform.size, &uniform.type, name.data());
+
+        uniform.name.assign(name.data(), length);
+        uniform.location = glGetUniformLocation(program.ID, uniform.name.c_str());
+
+        // Block members
+        if (uniform.location < 0)
+            continue;
+
+        // Arrays are reported as "name[0]" - the location is the first element's either way
+        if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+            uniform.name.erase(uniform.name.size() - 3);
+
+        program.handles[uniform.name] = (UniformHandle)program.uniforms.size();
+        program.uniforms.push_back(uniform);
+    }
+}
+
+UniformHandle FindUniform(const ShaderProgram& program, const std::string& name)
+{
+    auto found = program.handles.find(name);
+    return found != program.handles.end() ? found->second : UNIFORM_NONE;
+}
+
+void UseShaderProgram(const ShaderProgram& program)
+{
+    glUseProgram(program.ID);
+}
+
+static GLint Location(const ShaderProgram& program, UniformHandle handle)
+{
+    return handle == UNIFORM_NONE ? -1 : program.uniforms[handle].location;
+}
+
+void SetUniform(const ShaderProgram& program, UniformHandle handle, int value)
+{
+    glUniform1i(Location(program, handle), value);
+}
+
+void SetUniform(const ShaderProgram& program, UniformHandle handle, GLuint value)
+{
+    glUniform1ui(Location(program, handle), value);
+}
+
+void SetUniform(const ShaderProgram& program, UniformHandle handle, float value)
+{
+    glUniform1f(Location(program, handle), value);
+}
+
+void SetUniform(const ShaderProgram& program, UniformHandle handle, const glm::vec2& value)
+{
+    glUniform2fv(Location(program, handle), 1, glm::value_ptr(value));
+}
+
+void SetUniform(const ShaderProgram& program, UniformHandle handle, const glm::vec3& value)
+{
+    glUniform3fv(Location(program, handle), 1, glm::value_ptr(value));
+}
+
+void SetUniform(const ShaderProgram& program, UniformHandle handle, const glm::vec4& value)
+{
+    glUniform4fv(Location(program, handle), 1, glm::value_ptr(value));
+}
+
+void SetUniform(const ShaderProgram& program, UniformHandle handle, const glm::mat4& value)
+{
+    glUniformMatrix4fv(Location(program, handle), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void CleanupShaderProgram(ShaderProgram& program)
+{
+    glDeleteProgram(program.ID);
+    program = ShaderProgram();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "shaders/LoadShaders.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// SHADER PROGRAM
+//
+// A linked program plus a table of every active uniform, read back from the
+// driver once, straight after linking. Code that draws resolves the names it
+// needs to UniformHandles when it is set up (FindUniform) and the setters only
+// index the table, so nothing per draw hashes a string or asks GL for a
+// location.
+//
+// A name that is not active - misspelt, or optimised out because the shader
+// never reads it - resolves to UNIFORM_NONE, which every setter ignores, the
+// same way GL ignores location -1. Members of uniform blocks (the Camera block
+// in camera.h) have no location and are left out of the table.
+//
+// Linked programs are cached on disk with glGetProgramBinary, next to their
+// first stage as <file>.<stage list hash>.glbin. The key covers every stage's
+// source and the GL vendor, renderer and version strings. A key mismatch or a
+// binary the driver refuses falls back to compiling, and the fresh binary
+// replaces the old one.
+// -----------------------------------------------------------------------------
+typedef int UniformHandle;
+constexpr UniformHandle UNIFORM_NONE = -1;
+
+struct ShaderUniform
+{
+    std::string name;     // arrays without the trailing [0]
+    GLint location = -1;
+    GLenum type = GL_NONE;
+    GLint size = 1;       // array length
+};
+
+struct ShaderProgram
+{
+    GLuint ID = 0;
+    std::vector<ShaderUniform> uniforms;                   // index = UniformHandle
+    std::unordered_map<std::string, UniformHandle> handles;
+
+    bool fromCache = false;   // loaded with glProgramBinary, nothing compiled
+};
+
+// Loads the program from the binary cache, or builds it with LoadShaders and
+// caches it, then reflects its uniforms. Returns false (and leaves ID at 0) if
+// any stage fails to compile or the link fails.
+bool LoadShaderProgram(ShaderProgram& program, ShaderInfo* shaders);
+bool LoadShaderProgram(ShaderProgram& program, const char* vertexPath, const char* fragmentPath);
+
+// Fills the table from an already linked program
+void ReflectUniforms(ShaderProgram& program);
+
+UniformHandle FindUniform(const ShaderProgram& program, const std::string& name);
+
+void UseShaderProgram(const ShaderProgram& program);
+
+// These set uniforms on the program in use, so bind it first
+void SetUniform(const ShaderProgram& program, UniformHandle handle, int value);
+void SetUniform(const ShaderProgram& program, UniformHandle handle, GLuint value);
+void SetUniform(const ShaderProgram& program, UniformHandle handle, float value);
+void SetUniform(const ShaderProgram& program, UniformHandle handle, const glm::vec2& value);
+void SetUniform(const ShaderProgram& program, UniformHandle handle, const glm::vec3& value);
+void SetUniform(const ShaderProgram& program, UniformHandle handle, const glm::vec4& value);
+void SetUniform(const ShaderProgram& program, UniformHandle handle, const glm::mat4& value);
+
+void CleanupShaderProgram(ShaderProgram& program);
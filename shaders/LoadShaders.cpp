@@ -7,9 +7,10 @@
 #include <cstdlib>
 #include <iostream>
 
-#include "GL/glew.h"
+#include <glad/glad.h>
 #include "GLFW/glfw3.h"
 #include "LoadShaders.h"
+#include "../assetfile.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,33 +18,28 @@ extern "C" {
 
 	//----------------------------------------------------------------------------
 
-	static const GLchar*
-		ReadShader(const char* filename)
+	// The mapped file goes to the compiler as is - glShaderSource takes
+	// the length, so the source needs no copy or NUL terminator
+	static bool
+		MapShader(const char* filename, AssetFile& file)
 	{
-
-		FILE* infile;
-		fopen_s(&infile, filename, "rb");
-
-
-		if (!infile) {
+		if (!OpenAssetFile(filename, file)) {
 #ifdef _DEBUG
 			std::cerr << "Unable to open file '" << filename << "'" << std::endl;
 #endif /* DEBUG */
-			return NULL;
+			return false;
 		}
 
-		fseek(infile, 0, SEEK_END);
-		int len = ftell(infile);
-		fseek(infile, 0, SEEK_SET);
-
-		GLchar* source = new GLchar[len + 1];
-
-		fread(source, 1, len, infile);
-		fclose(infile);
-
-		source[len] = 0;
+		// An empty file maps to a null pointer, which glShaderSource must not be given
+		if (file.size == 0) {
+#ifdef _DEBUG
+			std::cerr << "Shader file '" << filename << "' is empty" << std::endl;
+#endif /* DEBUG */
+			CloseAssetFile(file);
+			return false;
+		}
 
-		return const_cast<const GLchar*>(source);
+		return true;
 	}
 
 	//----------------------------------------------------------------------------
@@ -55,14 +51,19 @@ extern "C" {
 
 		GLuint program = glCreateProgram();
 
+		// So the program binary cache (shaderprogram.cpp) can read it back
+		if (GLAD_GL_VERSION_4_1) {
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
 		ShaderInfo* entry = shaders;
 		while (entry->type != GL_NONE) {
 			GLuint shader = glCreateShader(entry->type);
 
 			entry->shader = shader;
 
-			const GLchar* source = ReadShader(entry->filename);
-			if (source == NULL) {
+			AssetFile file;
+			if (!MapShader(entry->filename, file)) {
 				for (entry = shaders; entry->type != GL_NONE; ++entry) {
 					glDeleteShader(entry->shader);
 					entry->shader = 0;
@@ -71,8 +72,10 @@ extern "C" {
 				return 0;
 			}
 
-			glShaderSource(shader, 1, &source, NULL);
-			delete[] source;
+			const GLchar* source = (const GLchar*)file.data;
+			GLint length = (GLint)file.size;
+			glShaderSource(shader, 1, &source, &length);
+			CloseAssetFile(file);
 
 			glCompileShader(shader);
 
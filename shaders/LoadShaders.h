@@ -7,7 +7,7 @@
 #ifndef __LOAD_SHADERS_H__
 #define __LOAD_SHADERS_H__
 
-#include "GL/glew.h"
+#include <glad/glad.h>
 
 #ifdef __cplusplus
 extern "C" {
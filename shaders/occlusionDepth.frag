@@ -0,0 +1,6 @@
+#version 460 core
+
+// Depth is all the Hi-Z pass needs - no colour attachment
+void main()
+{
+}
\ No newline at end of file
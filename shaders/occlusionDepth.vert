@@ -0,0 +1,34 @@
+#version 460 core
+
+// Depth-only occluder pass into the Hi-Z buffer. The draw reuses last frame's
+// indirect commands, so each instance fetches this frame's matrix through the
+// item index the cull pass stored beside it rather than the stale instance buffer.
+layout (location = 0) in vec3 position;
+
+// Mirrors OcclusionItem in occlusion.h
+struct Item
+{
+    mat4 world;
+    vec4 boundsMin;
+    vec4 boundsMax;
+    uint model;
+    uint padding[3];
+};
+
+layout (std430, binding = 0) readonly buffer Items { Item items[]; };
+layout (std430, binding = 8) readonly buffer VisibleItems { uint visibleItems[]; };
+
+// Per-frame camera (CAMERA_UBO_BINDING)
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+void main()
+{
+    mat4 world = items[visibleItems[gl_BaseInstance + gl_InstanceID]].world;
+    gl_Position = viewProjection * world * vec4(position, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 460 core
+
+in vec2 textureFrag;
+flat in uint layerFrag;
+
+out vec4 FragColor;
+
+uniform sampler2DArray sceneTextures;
+
+void main()
+{
+    FragColor = texture(sceneTextures, vec3(textureFrag, float(layerFrag)));
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 460 core
+
+// vertexShader.vert for the merged scene - one multi-draw per texture array, gl_DrawID picks the mesh
+layout (location = 0) in vec3 position;
+layout (location = 2) in vec2 textureVertex;
+layout (location = 7) in mat4 instanceModel;
+
+// Texture array layer of each draw (GPU_SCENE_DRAW_DATA_BINDING)
+layout (std430, binding = 7) readonly buffer DrawData { uint textureLayer[]; };
+
+// First command of this multi-draw, as gl_DrawID counts from 0 in each
+uniform uint drawBase;
+
+// Per-frame camera (CAMERA_UBO_BINDING)
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+out vec2 textureFrag;
+flat out uint layerFrag;
+
+void main()
+{
+    gl_Position = viewProjection * instanceModel * vec4(position, 1.0);
+    textureFrag = textureVertex;
+    layerFrag = textureLayer[drawBase + gl_DrawID];
+}
\ No newline at end of file
@@ -2,13 +2,146 @@
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 colourVertex;
+layout (location = 2) in vec2 clipmapGrid;
+layout (location = 3) in float packedHeight;   // 0..1 from a normalised ushort
 
-uniform mat4 mvpIn;
+// Per-frame camera (CAMERA_UBO_BINDING)
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+// Terrain space -> world; the only per-draw matrix left
+uniform mat4 modelIn;
+
+// 0 = baked mesh, 1 = clipmap (heights read from heightMap), 2 = compact baked mesh
+uniform int terrainMode;
+
+// Compact mesh - each chunk owns a (chunkSize + 1)^2 block of vertices in row-major
+// chunk order, so gl_VertexID (which includes baseVertex) gives x/z
+uniform int chunkSize;
+uniform int chunksPerSide;
+uniform float gridSpacing;
+uniform float heightMin;
+uniform float heightRange;
+
+uniform sampler2D heightMap;      // clipmap, and mesh modes with lodMorph
+uniform float heightMapSpacing;  // terrain units between texels
+uniform vec2 clipmapOrigin;      // level's cell (0,0) in terrain space
+uniform vec2 clipmapOffset;      // where this piece sits inside the level, in cells
+uniform float clipmapSpacing;    // level's cell size
+uniform float clipmapSize;       // level width in cells
+uniform vec3 sandColour;
+
+// Mesh modes with LOD - heights are morphed towards the next coarser level
+// through a band before each LOD distance, so a chunk switching level has
+// already taken the coarser shape. A vertex's height depends only on where it
+// is, never on the level its chunk is drawn at, so chunks on either side of a
+// level change agree along their shared edge.
+uniform int lodMorph;            // 0 = off
+uniform float lodDistance;       // full density inside this, doubling per level
+uniform int lodLevels;
+uniform vec3 lodCamera;          // camera in terrain space
+
+const float LOD_MORPH_BAND = 0.25;   // fraction of each level's distance spent morphing, <= 0.5
 
 out vec3 colourFrag;
 
+// Mesh mode heightMap holds one texel per grid vertex, packed like the vertices
+float GridHeight(ivec2 grid)
+{
+    ivec2 last = textureSize(heightMap, 0) - 1;
+    return heightMin + texelFetch(heightMap, clamp(grid, ivec2(0), last), 0).r * heightRange;
+}
+
+// The surface a chunk drawn at this level has at grid: linear over the half of
+// the level's cell that holds it, split along the same top-right to
+// bottom-left diagonal as the index patterns
+float LevelHeight(ivec2 grid, int level)
+{
+    int stride = 1 << level;
+    ivec2 last = textureSize(heightMap, 0) - 1;
+    ivec2 corner0 = grid - grid % stride;
+    ivec2 corner1 = min(corner0 + stride, last);
+    vec2 t = vec2(grid - corner0) / vec2(max(corner1 - corner0, ivec2(1)));
+
+    float topLeft = GridHeight(corner0);
+    float topRight = GridHeight(ivec2(corner1.x, corner0.y));
+    float bottomLeft = GridHeight(ivec2(corner0.x, corner1.y));
+    float bottomRight = GridHeight(corner1);
+
+    if (t.x + t.y <= 1.0)
+        return topLeft + t.x * (topRight - topLeft) + t.y * (bottomLeft - topLeft);
+    return bottomRight + (1.0 - t.x) * (bottomLeft - bottomRight) + (1.0 - t.y) * (topRight - bottomRight);
+}
+
+float MorphedHeight(ivec2 grid)
+{
+    float height = GridHeight(grid);
+    vec3 vertex = vec3(float(grid.x) * gridSpacing, height, float(grid.y) * gridSpacing);
+    float distance = length(lodCamera - vertex);
+
+    // Same level choice as SelectLodLevel, for this vertex alone
+    int level = 0;
+    float band = lodDistance;
+    while (distance >= band && level + 1 < lodLevels)
+    {
+        band *= 2.0;
+        level++;
+    }
+
+    if (level + 1 >= lodLevels)
+        return LevelHeight(grid, level);
+
+    float morph = clamp((distance - band * (1.0 - LOD_MORPH_BAND)) / (band * LOD_MORPH_BAND), 0.0, 1.0);
+    return mix(LevelHeight(grid, level), LevelHeight(grid, level + 1), morph);
+}
+
 void main()
 {
-    gl_Position = mvpIn * vec4(position, 1.0);
+    if (terrainMode == 1)
+    {
+        vec2 cell = clipmapGrid + clipmapOffset;
+
+        // Towards the outer edge, slide odd vertices onto the next level's
+        // lattice so the two levels meet without cracks or popping
+        float halfSize = clipmapSize * 0.5;
+        float morphRange = clipmapSize * 0.125;
+        float edgeDistance = max(abs(cell.x - halfSize), abs(cell.y - halfSize));
+        float morph = clamp((edgeDistance - (halfSize - morphRange)) / morphRange, 0.0, 1.0);
+        cell -= mod(cell, 2.0) * morph;
+
+        vec2 terrainXZ = clipmapOrigin + cell * clipmapSpacing;
+        vec2 uv = (terrainXZ / heightMapSpacing + 0.5) / vec2(textureSize(heightMap, 0));
+        float height = textureLod(heightMap, uv, 0.0).r;
+
+        gl_Position = viewProjection * modelIn * vec4(terrainXZ.x, height, terrainXZ.y, 1.0);
+        colourFrag = sandColour;
+        return;
+    }
+
+    if (terrainMode == 2)
+    {
+        int pitch = chunkSize + 1;
+        int chunk = gl_VertexID / (pitch * pitch);
+        int local = gl_VertexID % (pitch * pitch);
+
+        ivec2 grid = ivec2((chunk % chunksPerSide) * chunkSize + local % pitch,
+                           (chunk / chunksPerSide) * chunkSize + local / pitch);
+        float height = (lodMorph != 0) ? MorphedHeight(grid) : heightMin + packedHeight * heightRange;
+
+        gl_Position = viewProjection * modelIn * vec4(float(grid.x) * gridSpacing, height, float(grid.y) * gridSpacing, 1.0);
+        colourFrag = sandColour;
+        return;
+    }
+
+    vec3 meshPosition = position;
+    if (lodMorph != 0)
+        meshPosition.y = MorphedHeight(ivec2(round(position.xz / gridSpacing)));
+
+    gl_Position = viewProjection * modelIn * vec4(meshPosition, 1.0);
     colourFrag = colourVertex;
 }
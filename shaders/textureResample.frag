@@ -0,0 +1,13 @@
+#version 460 core
+
+in vec2 textureFrag;
+
+out vec4 FragColor;
+
+// Drawn at the source's own size, so each fragment lands on one source texel
+uniform sampler2D source;
+
+void main()
+{
+    FragColor = texture(source, textureFrag);
+}
\ No newline at end of file
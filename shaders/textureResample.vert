@@ -0,0 +1,11 @@
+#version 460 core
+
+// One triangle covering the viewport, from gl_VertexID - no vertex buffer
+out vec2 textureFrag;
+
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    textureFrag = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
\ No newline at end of file
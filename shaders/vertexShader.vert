@@ -3,9 +3,17 @@
 layout (location = 0) in vec3 position;
 //Texture coordinates from last stage
 layout (location = 2) in vec2 textureVertex;
+//Per-instance world matrix (takes locations 7-10, see instancing.h)
+layout (location = 7) in mat4 instanceModel;
 
-//Model-View-Projection Matrix
-uniform mat4 mvpIn;
+//Per-frame camera, uploaded once and shared by every program (see camera.h)
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
 
 //Texture to send
 out vec2 textureFrag;
@@ -13,7 +21,7 @@ out vec2 textureFrag;
 void main()
 {
     //Transformation applied to vertices
-    gl_Position = mvpIn * vec4(position.x, position.y, position.z, 1.0);
+    gl_Position = viewProjection * instanceModel * vec4(position.x, position.y, position.z, 1.0);
     //Sending texture coordinates to next stage
     textureFrag = textureVertex;
 }
\ No newline at end of file
@@ -1,22 +1,21 @@
 #include "terrain.h"
+#include "frustum.h"
+#include "parallel.h"
+#include "noise_simd.h"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
-#include <learnOpenGL/shader_m.h>
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <chrono>
+#include <cstring>
 
-#define TERRAIN_RENDER_DIST 256
-#define TERRAIN_MAP_SIZE (TERRAIN_RENDER_DIST * TERRAIN_RENDER_DIST)
-constexpr float TERRAIN_SPACING = 1.0f;
-
-//static GLuint terrainVAO = 0;
-//static GLuint terrainVBO = 0;
-//static GLuint terrainEBO = 0;
-
-static GLfloat terrainVertices[TERRAIN_MAP_SIZE][6];
-static GLuint terrainIndices[(TERRAIN_MAP_SIZE - 1) * (TERRAIN_RENDER_DIST - 1) * 2][3];
+// sandy colour - per vertex in the full format, a uniform everywhere else
+const glm::vec3 TERRAIN_SAND_COLOUR = glm::vec3(0.85f, 0.80f, 0.55f);
 
 constexpr glm::vec2 CAVE_CENTER = glm::vec2(0.0f, 0.0f);
 
@@ -24,118 +23,999 @@ constexpr float BOWL_RADIUS = 300.0f;
 constexpr float BOWL_DEPTH = -18.0f;
 constexpr float BOWL_HEIGHT = 25.0f;
 
+// Baking every height (bowl + dunes) should not stall startup longer than this
+constexpr double TERRAIN_BAKE_BUDGET_MS = 250.0;
 
 
-void InitialiseTerrain(TerrainInstance& terrain, bool inverted)
+
+// Smoothstep bowl (or upside-down cap) around terrain.center
+static float BowlHeight(const TerrainInstance& terrain, float x, float z, bool inverted)
+{
+    float distance = glm::length(glm::vec2(x, z) - terrain.center);
+    float t = glm::clamp(distance / terrain.bowlRadius, 0.0f, 1.0f);
+    float smoothT = t * t * (3.0f - 2.0f * t);
+
+    return inverted
+        ? glm::mix(terrain.bowlHeight, terrain.bowlDepth, smoothT) // cap
+        : glm::mix(terrain.bowlDepth, terrain.bowlHeight, smoothT); // bowl
+}
+
+// Every grid vertex's height, row-major, baked on threads workers. Rows are
+// independent, and each row's noise starts from its own z rather than from the
+// first row of whichever block a worker got, so any thread count produces
+// exactly the same buffer.
+static void BakeHeightRows(const TerrainInstance& terrain, bool inverted, int threads, std::vector<GLfloat>& heights)
+{
+    heights.assign(terrain.renderDist * terrain.renderDist, 0.0f);
+
+    // Ridged noise peaks sharply at 0, which reads as dune crests. Squashing x
+    // before sampling stretches the crests along it, like wind-blown ridges.
+    FastNoiseLite noise(terrain.duneSeed);
+    noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+    noise.SetFractalType(FastNoiseLite::FractalType_Ridged);
+    noise.SetFractalOctaves(terrain.duneOctaves);
+    noise.SetFrequency(1.0f / terrain.duneWavelength);
+
+    ParallelFor(0, terrain.renderDist, threads, [&](int firstRow, int lastRow)
+    {
+        for (int z = firstRow; z < lastRow; z++)
+        {
+            GLfloat* row = heights.data() + z * terrain.renderDist;
+
+            if (terrain.duneHeight != 0.0f)
+            {
+                NoiseSimd::GetNoiseGrid(noise, row, 0.0f, z * terrain.spacing, terrain.renderDist, 1,
+                    terrain.spacing / terrain.duneStretch, terrain.spacing);
+            }
+
+            for (int x = 0; x < terrain.renderDist; x++)
+            {
+                float dune = (terrain.duneHeight != 0.0f) ? (row[x] * 0.5f + 0.5f) * terrain.duneHeight : 0.0f;
+                row[x] = BowlHeight(terrain, x * terrain.spacing, z * terrain.spacing, inverted) + dune;
+            }
+        }
+    });
+}
+
+static std::vector<GLfloat> BakeHeights(const TerrainInstance& terrain, bool inverted)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<GLfloat> heights;
+    BakeHeightRows(terrain, inverted, terrain.generationThreads, heights);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (ms > TERRAIN_BAKE_BUDGET_MS)
+    {
+        std::cout << "Terrain heights took " << ms << " ms to bake (budget "
+            << TERRAIN_BAKE_BUDGET_MS << " ms)\n";
+    }
+
+#ifdef _DEBUG
+    // Debug builds check the threaded bake against a serial one, bit for bit
+    std::vector<GLfloat> serial;
+    BakeHeightRows(terrain, inverted, 1, serial);
+
+    size_t differing = 0;
+    for (size_t i = 0; i < heights.size(); i++)
+    {
+        if (std::memcmp(&heights[i], &serial[i], sizeof(GLfloat)) != 0)
+            differing++;
+    }
+
+    if (differing > 0)
+        std::cout << "Terrain bake: " << differing << " heights differ from a serial bake\n";
+#endif
+
+    return heights;
+}
+
+// -----------------------------------------------------------------------------
+// LOD INDEX PATTERNS
+//
+// Level l samples every (1 << l)th vertex. The last row/column of a chunk is
+// always kept so partial chunks at the grid edge still meet their neighbours.
+//
+// Seams: when a neighbour is one level coarser, vertices on that shared edge
+// are snapped down onto the neighbour's stride. The fine side then matches
+// the coarse side exactly and the collapsed triangles are dropped.
+// -----------------------------------------------------------------------------
+static int SnapToStride(int value, int stride, int edgeEnd)
+{
+    return (value == edgeEnd) ? value : (value / stride) * stride;
+}
+
+// pitch is the row length of a chunk's vertex block (chunkSize + 1)
+static void BuildPatternIndices(int pitch, int width, int height,
+    int level, int stitchMask, TerrainIndexOrder order, std::vector<GLushort>& indices)
+{
+    int stride = 1 << level;
+    int coarse = stride * 2;
+
+    std::vector<int> xs;
+    std::vector<int> zs;
+    for (int x = 0; x < width; x += stride) xs.push_back(x);
+    for (int z = 0; z < height; z += stride) zs.push_back(z);
+    xs.push_back(width);
+    zs.push_back(height);
+
+    auto snap = [&](int x, int z) -> glm::ivec2
+    {
+        if ((stitchMask & TERRAIN_EDGE_NORTH) && z == 0)      x = SnapToStride(x, coarse, width);
+        if ((stitchMask & TERRAIN_EDGE_SOUTH) && z == height) x = SnapToStride(x, coarse, width);
+        if ((stitchMask & TERRAIN_EDGE_WEST) && x == 0)       z = SnapToStride(z, coarse, height);
+        if ((stitchMask & TERRAIN_EDGE_EAST) && x == width)   z = SnapToStride(z, coarse, height);
+
+        return glm::ivec2(x, z);
+    };
+
+    // Twice the signed area in the xz plane - negative for the grid's usual winding
+    auto winding = [](glm::ivec2 a, glm::ivec2 b, glm::ivec2 c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    };
+
+    auto addTriangle = [&](glm::ivec2 a, glm::ivec2 b, glm::ivec2 c)
+    {
+        // Collapsed by a seam
+        if (winding(a, b, c) == 0)
+            return;
+
+        indices.push_back((GLushort)(a.y * pitch + a.x));
+        indices.push_back((GLushort)(b.y * pitch + b.x));
+        indices.push_back((GLushort)(c.y * pitch + c.x));
+    };
+
+    // Column strips walk down a few cells at a time, so the row above is still in the
+    // post-transform cache when the next row reuses it. Rows is one strip the full width.
+    size_t cellsX = xs.size() - 1;
+    size_t stripCells = (order == TerrainIndexOrder::ColumnStrips) ? TERRAIN_STRIP_CELLS : cellsX;
+
+    for (size_t strip = 0; strip < cellsX; strip += stripCells)
+    {
+        size_t stripEnd = std::min(strip + stripCells, cellsX);
+
+        for (size_t j = 0; j + 1 < zs.size(); j++)
+        {
+            for (size_t i = strip; i < stripEnd; i++)
+            {
+                glm::ivec2 topLeft = snap(xs[i], zs[j]);
+                glm::ivec2 topRight = snap(xs[i + 1], zs[j]);
+                glm::ivec2 bottomLeft = snap(xs[i], zs[j + 1]);
+                glm::ivec2 bottomRight = snap(xs[i + 1], zs[j + 1]);
+
+                // A corner cell stitched on two sides can fold over the usual diagonal, so use the other one
+                if (winding(topLeft, bottomLeft, topRight) > 0 || winding(topRight, bottomLeft, bottomRight) > 0)
+                {
+                    addTriangle(topLeft, bottomLeft, bottomRight);
+                    addTriangle(topLeft, bottomRight, topRight);
+                }
+                else
+                {
+                    addTriangle(topLeft, bottomLeft, topRight);
+                    addTriangle(topRight, bottomLeft, bottomRight);
+                }
+            }
+        }
+    }
+}
+
+// Chunks only come in a handful of sizes (full, plus clipped ones on the far edges),
+// so each size gets one set of patterns shared by every chunk of that size
+static int FindOrAddPattern(std::vector<TerrainPattern>& patterns, int width, int height)
+{
+    for (size_t i = 0; i < patterns.size(); i++)
+    {
+        if (patterns[i].width == width && patterns[i].height == height)
+            return (int)i;
+    }
+
+    TerrainPattern pattern;
+    pattern.width = width;
+    pattern.height = height;
+
+    patterns.push_back(pattern);
+    return (int)patterns.size() - 1;
+}
+
+// -----------------------------------------------------------------------------
+// SHARED INDEX BUFFERS
+//
+// Every chunk stores its vertices as its own (chunkSize + 1)^2 block, so the
+// patterns only depend on chunkSize - not on the terrain they belong to. One
+// GL_UNSIGNED_SHORT buffer per chunkSize and index order is shared by every instance, and
+// grows in place when an instance needs a chunk shape it has not seen yet.
+// -----------------------------------------------------------------------------
+struct TerrainIndexCache
+{
+    GLuint EBO = 0;
+    GLsizei indexCount = 0;
+    int refCount = 0;
+    std::vector<TerrainPattern> patterns;
+};
+
+typedef std::pair<int, TerrainIndexOrder> TerrainIndexKey;   // chunkSize, order
+
+static std::map<TerrainIndexKey, TerrainIndexCache> indexCaches;
+
+static TerrainIndexKey IndexKey(const TerrainInstance& terrain)
+{
+    return TerrainIndexKey(terrain.chunkSize, terrain.indexOrder);
+}
+
+// Builds patterns [firstPattern, end) - every (size, level, seam) job separately, then appended in a fixed order
+static std::vector<GLushort> BuildPatterns(TerrainIndexCache& cache, size_t firstPattern, int pitch,
+    TerrainIndexOrder order, int threads)
+{
+    const int perPattern = TERRAIN_MAX_LOD_LEVELS * 16;
+    const int jobCount = (int)(cache.patterns.size() - firstPattern) * perPattern;
+
+    std::vector<std::vector<GLushort>> results(jobCount);
+
+    ParallelFor(0, jobCount, threads, [&](int first, int last)
+    {
+        for (int job = first; job < last; job++)
+        {
+            const TerrainPattern& pattern = cache.patterns[firstPattern + job / perPattern];
+            int level = (job % perPattern) / 16;
+            int mask = job % 16;
+
+            // The coarsest level never borders anything coarser, so it only needs the plain pattern
+            if (mask == 0 || level + 1 < TERRAIN_MAX_LOD_LEVELS)
+                BuildPatternIndices(pitch, pattern.width, pattern.height, level, mask, order, results[job]);
+        }
+    });
+
+    std::vector<GLushort> indices;
+    for (int job = 0; job < jobCount; job++)
+    {
+        TerrainIndexRange& range = cache.patterns[firstPattern + job / perPattern].ranges[(job % perPattern) / 16][job % 16];
+        range.offset = cache.indexCount + (GLsizei)indices.size();
+        range.count = (GLsizei)results[job].size();
+
+        indices.insert(indices.end(), results[job].begin(), results[job].end());
+    }
+
+    return indices;
+}
+
+// Points terrain.EBO at the shared buffer for its chunk size and order, and fills in its pattern ranges
+static void AcquireSharedIndices(TerrainInstance& terrain)
 {
-    const int mapSize = terrain.renderDist * terrain.renderDist;
+    TerrainIndexCache& cache = indexCaches[IndexKey(terrain)];
+
+    size_t firstNew = cache.patterns.size();
+    for (TerrainPattern& pattern : terrain.patterns)
+        FindOrAddPattern(cache.patterns, pattern.width, pattern.height);
+
+    if (cache.patterns.size() > firstNew)
+    {
+        std::vector<GLushort> added = BuildPatterns(cache, firstNew, terrain.chunkSize + 1,
+            terrain.indexOrder, terrain.generationThreads);
+
+        GLsizeiptr oldBytes = cache.indexCount * sizeof(GLushort);
+        GLsizeiptr newBytes = oldBytes + added.size() * sizeof(GLushort);
+
+        if (cache.EBO == 0)
+            glGenBuffers(1, &cache.EBO);
+
+        // Grow through a scratch copy so the buffer name - and every VAO already bound to it - stays valid
+        GLuint scratch = 0;
+        if (oldBytes > 0)
+        {
+            glGenBuffers(1, &scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+            glBufferData(GL_COPY_WRITE_BUFFER, oldBytes, nullptr, GL_STATIC_COPY);
+            glBindBuffer(GL_COPY_READ_BUFFER, cache.EBO);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, cache.EBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
 
-    std::vector<GLfloat> vertices(mapSize * 6);
-    std::vector<GLuint> indices((terrain.renderDist - 1) *
-        (terrain.renderDist - 1) * 6);
+        if (scratch != 0)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+            glDeleteBuffers(1, &scratch);
+        }
 
-    float xOffset = 0.0f;
-    float zOffset = 0.0f;
-    int rowIndex = 0;
+        glBufferSubData(GL_COPY_WRITE_BUFFER, oldBytes, added.size() * sizeof(GLushort), added.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
 
-    for (int i = 0; i < mapSize; i++)
+        cache.indexCount += (GLsizei)added.size();
+    }
+
+    for (TerrainPattern& pattern : terrain.patterns)
+        pattern = cache.patterns[FindOrAddPattern(cache.patterns, pattern.width, pattern.height)];
+
+    cache.refCount++;
+    terrain.EBO = cache.EBO;
+    terrain.indexBytes = cache.indexCount * sizeof(GLushort);
+}
+
+static void ReleaseSharedIndices(TerrainInstance& terrain)
+{
+    auto it = indexCaches.find(IndexKey(terrain));
+    if (it == indexCaches.end() || it->second.EBO != terrain.EBO)
+        return;
+
+    if (--it->second.refCount == 0)
     {
-        int v = i * 6;
+        glDeleteBuffers(1, &it->second.EBO);
+        indexCaches.erase(it);
+    }
+}
 
-        vertices[v + 0] = xOffset;
-        vertices[v + 2] = zOffset;
+// Distance bands double per level: [0, d) -> 0, [d, 2d) -> 1, [2d, 4d) -> 2 ...
+static int SelectLodLevel(const TerrainInstance& terrain, const TerrainChunk& chunk, const glm::vec3& cameraLocal)
+{
+    glm::vec3 closest = glm::clamp(cameraLocal, chunk.boundsMin, chunk.boundsMax);
+    float distance = glm::length(cameraLocal - closest);
 
-        float distance = glm::length(glm::vec2(xOffset, zOffset) - terrain.center);
-        float t = glm::clamp(distance / terrain.bowlRadius, 0.0f, 1.0f);
-        float smoothT = t * t * (3.0f - 2.0f * t);
+    int level = 0;
+    float band = terrain.lodDistance;
+    while (distance >= band && level + 1 < terrain.lodLevels)
+    {
+        band *= 2.0f;
+        level++;
+    }
 
-        float height = inverted
-            ? glm::mix(terrain.bowlHeight, terrain.bowlDepth, smoothT) // cap
-            : glm::mix(terrain.bowlDepth, terrain.bowlHeight, smoothT); // bowl
+    return level;
+}
 
-        vertices[v + 1] = height;
 
-        // sandy colour
-        vertices[v + 3] = 0.85f;
-        vertices[v + 4] = 0.80f;
-        vertices[v + 5] = 0.55f;
 
-        xOffset += terrain.spacing;
-        rowIndex++;
+// -----------------------------------------------------------------------------
+// CLIPMAP
+//
+// Level l is a clipmapSize x clipmapSize grid of cells (spacing << l) kept
+// centred on the camera. Level 0 is a solid block, every level above it is a
+// ring whose hole is one cell wider than the level inside it. Which side of
+// the hole that spare cell ends up on depends on how the finer level snapped,
+// so it is filled by an L of two trim strips placed each frame.
+//
+// Heights come from the heightMap texture in terrain.vert, so these meshes
+// never change - only a few uniforms move them around.
+// -----------------------------------------------------------------------------
+
+// Appends a cellsX x cellsZ grid (skipping quads inside the hole) using the
+// same winding as the baked mesh
+static TerrainIndexRange AppendClipmapGrid(int cellsX, int cellsZ, glm::ivec2 holeMin, glm::ivec2 holeMax,
+    std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+{
+    GLuint base = (GLuint)(vertices.size() / 2);
 
-        if (rowIndex == terrain.renderDist)
+    for (int z = 0; z <= cellsZ; z++)
+    {
+        for (int x = 0; x <= cellsX; x++)
         {
-            rowIndex = 0;
-            xOffset = 0.0f;
-            zOffset += terrain.spacing;
+            vertices.push_back((float)x);
+            vertices.push_back((float)z);
         }
     }
 
-    // indices (same logic you already have)
-    int idx = 0;
-    for (int z = 0; z < terrain.renderDist - 1; z++)
+    TerrainIndexRange range;
+    range.offset = (GLsizei)indices.size();
+
+    for (int z = 0; z < cellsZ; z++)
     {
-        for (int x = 0; x < terrain.renderDist - 1; x++)
+        for (int x = 0; x < cellsX; x++)
         {
-            int topLeft = z * terrain.renderDist + x;
-            int topRight = topLeft + 1;
-            int bottomLeft = topLeft + terrain.renderDist;
-            int bottomRight = bottomLeft + 1;
+            if (x >= holeMin.x && x < holeMax.x && z >= holeMin.y && z < holeMax.y)
+                continue;
+
+            GLuint topLeft = base + z * (cellsX + 1) + x;
+            GLuint topRight = topLeft + 1;
+            GLuint bottomLeft = topLeft + (cellsX + 1);
+            GLuint bottomRight = bottomLeft + 1;
 
-            indices[idx++] = topLeft;
-            indices[idx++] = bottomLeft;
-            indices[idx++] = topRight;
+            indices.push_back(topLeft);
+            indices.push_back(bottomLeft);
+            indices.push_back(topRight);
 
-            indices[idx++] = topRight;
-            indices[idx++] = bottomLeft;
-            indices[idx++] = bottomRight;
+            indices.push_back(topRight);
+            indices.push_back(bottomLeft);
+            indices.push_back(bottomRight);
         }
     }
 
+    range.count = (GLsizei)indices.size() - range.offset;
+    return range;
+}
+
+static void InitialiseClipmap(TerrainInstance& terrain, bool inverted)
+{
+    // Bake the bowl into a float heightmap, one texel per grid vertex
+    std::vector<GLfloat> heights = BakeHeights(terrain, inverted);
+
+    glGenTextures(1, &terrain.heightMap);
+    glBindTexture(GL_TEXTURE_2D, terrain.heightMap);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, terrain.renderDist, terrain.renderDist, 0,
+        GL_RED, GL_FLOAT, heights.data());
+    terrain.textureBytes = heights.size() * sizeof(GLfloat);
+
+    // Outside the baked area the edge heights carry on outwards
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Shared meshes, in cells
+    terrain.clipmapSize = std::max(8, terrain.clipmapSize / 4 * 4);
+    terrain.clipmapLevels = std::max(1, terrain.clipmapLevels);
+
+    const int size = terrain.clipmapSize;
+    const int holeStart = size / 4 - 1;
+    const int holeEnd = holeStart + size / 2 + 1;
+
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+    TerrainClipmap& clipmap = terrain.clipmap;
+
+    clipmap.block = AppendClipmapGrid(size, size, glm::ivec2(0), glm::ivec2(0), vertices, indices);
+    clipmap.ring = AppendClipmapGrid(size, size, glm::ivec2(holeStart), glm::ivec2(holeEnd), vertices, indices);
+    clipmap.trimVertical = AppendClipmapGrid(1, size / 2 + 1, glm::ivec2(0), glm::ivec2(0), vertices, indices);
+    clipmap.trimHorizontal = AppendClipmapGrid(size / 2, 1, glm::ivec2(0), glm::ivec2(0), vertices, indices);
+
+    glGenVertexArrays(1, &clipmap.VAO);
+    glGenBuffers(1, &clipmap.VBO);
+    glGenBuffers(1, &clipmap.EBO);
+
+    glBindVertexArray(clipmap.VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, clipmap.VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+    terrain.vertexBytes = vertices.size() * sizeof(GLfloat);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, clipmap.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    terrain.indexBytes = indices.size() * sizeof(GLuint);
+
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+}
+
+static void DrawClipmapPiece(const ShaderProgram& shader, const TerrainUniforms& uniforms, const TerrainIndexRange& range,
+    glm::vec2 offset, TerrainDrawStats& stats)
+{
+    SetUniform(shader, uniforms.clipmapOffset, offset);
+    glDrawElements(GL_TRIANGLES, range.count, GL_UNSIGNED_INT, (void*)(range.offset * sizeof(GLuint)));
+
+    stats.trianglesSubmitted += range.count / 3;
+}
+
+static TerrainDrawStats DrawClipmap(const TerrainInstance& terrain, const ShaderProgram& shader, const TerrainUniforms& uniforms,
+    const glm::vec3& cameraLocal)
+{
+    TerrainDrawStats stats;
+    stats.chunksTotal = terrain.clipmapLevels;
+    stats.chunksDrawn = terrain.clipmapLevels;
+
+    const TerrainClipmap& clipmap = terrain.clipmap;
+    const int size = terrain.clipmapSize;
+    const int holeStart = size / 4 - 1;
+
+    SetUniform(shader, uniforms.terrainMode, 1);
+    SetUniform(shader, uniforms.heightMap, 0);
+    SetUniform(shader, uniforms.heightMapSpacing, terrain.spacing);
+    SetUniform(shader, uniforms.clipmapSize, (float)size);
+    SetUniform(shader, uniforms.sandColour, TERRAIN_SAND_COLOUR);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, terrain.heightMap);
+    glBindVertexArray(clipmap.VAO);
+
+    // Level 0 - snapped to the next level's lattice so the rings above line up with it
+    glm::vec2 camera(cameraLocal.x, cameraLocal.z);
+    float spacing = terrain.spacing;
+    glm::vec2 origin = glm::floor(camera / (2.0f * spacing)) * (2.0f * spacing) - (size / 2) * spacing;
+
+    SetUniform(shader, uniforms.clipmapOrigin, origin);
+    SetUniform(shader, uniforms.clipmapSpacing, spacing);
+    DrawClipmapPiece(shader, uniforms, clipmap.block, glm::vec2(0.0f), stats);
+
+    glm::vec2 childOrigin = origin;
+
+    for (int level = 1; level < terrain.clipmapLevels; level++)
+    {
+        spacing *= 2.0f;
+
+        // Snap to twice this level's spacing, keeping the child at cell holeStart or holeStart + 1
+        origin = glm::floor((childOrigin - holeStart * spacing) / (2.0f * spacing)) * (2.0f * spacing);
+
+        glm::vec2 childCell = (childOrigin - origin) / spacing;
+        bool childLowX = childCell.x < holeStart + 0.5f;
+        bool childLowZ = childCell.y < holeStart + 0.5f;
+
+        float trimColumn = (float)(childLowX ? holeStart + size / 2 : holeStart);
+        float trimRow = (float)(childLowZ ? holeStart + size / 2 : holeStart);
+
+        SetUniform(shader, uniforms.clipmapOrigin, origin);
+        SetUniform(shader, uniforms.clipmapSpacing, spacing);
+
+        DrawClipmapPiece(shader, uniforms, clipmap.ring, glm::vec2(0.0f), stats);
+        DrawClipmapPiece(shader, uniforms, clipmap.trimVertical, glm::vec2(trimColumn, (float)holeStart), stats);
+        DrawClipmapPiece(shader, uniforms, clipmap.trimHorizontal, glm::vec2(glm::floor(childCell.x + 0.5f), trimRow), stats);
+
+        childOrigin = origin;
+    }
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return stats;
+}
+
+
+
+// Mesh mode: the grid heights as heightMap for terrain.vert's LOD morph. Compact
+// terrains quantise them exactly like their vertices, into GL_R16.
+static void UploadMorphHeights(TerrainInstance& terrain, const std::vector<GLfloat>& heights)
+{
+    glGenTextures(1, &terrain.heightMap);
+    glBindTexture(GL_TEXTURE_2D, terrain.heightMap);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (terrain.vertexFormat == TerrainVertexFormat::Compact)
+    {
+        std::vector<GLushort> packed(heights.size());
+        for (size_t i = 0; i < heights.size(); i++)
+        {
+            float t = (heights[i] - terrain.heightMin) / terrain.heightRange;
+            packed[i] = (GLushort)(glm::clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f);
+        }
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, terrain.renderDist, terrain.renderDist, 0,
+            GL_RED, GL_UNSIGNED_SHORT, packed.data());
+        terrain.textureBytes = packed.size() * sizeof(GLushort);
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, terrain.renderDist, terrain.renderDist, 0,
+            GL_RED, GL_FLOAT, heights.data());
+        terrain.textureBytes = heights.size() * sizeof(GLfloat);
+    }
+
+    // Only ever read with texelFetch
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void InitialiseTerrain(TerrainInstance& terrain, bool inverted)
+{
+    if (terrain.mode == TerrainMode::Clipmap)
+    {
+        InitialiseClipmap(terrain, inverted);
+        return;
+    }
+
+    std::vector<GLfloat> heights = BakeHeights(terrain, inverted);
+
+    // chunks - each one owns a (chunkSize + 1)^2 block of vertices and draws
+    // through a shared index pattern for its size, offset by baseVertex
+    terrain.chunkSize = glm::clamp(terrain.chunkSize, 2, 255);   // 16-bit indices
+    terrain.lodLevels = glm::clamp(terrain.lodLevels, 1, TERRAIN_MAX_LOD_LEVELS);
+
+    const int quads = terrain.renderDist - 1;
+    const int chunksPerSide = (quads + terrain.chunkSize - 1) / terrain.chunkSize;
+    const int pitch = terrain.chunkSize + 1;
+    const int chunkVertices = pitch * pitch;
+
+    terrain.chunksPerSide = chunksPerSide;
+    terrain.chunks.clear();
+    terrain.chunks.reserve(chunksPerSide * chunksPerSide);
+    terrain.patterns.clear();
+
+    for (int cz = 0; cz < chunksPerSide; cz++)
+    {
+        for (int cx = 0; cx < chunksPerSide; cx++)
+        {
+            int x0 = cx * terrain.chunkSize;
+            int z0 = cz * terrain.chunkSize;
+            int x1 = std::min(x0 + terrain.chunkSize, quads);
+            int z1 = std::min(z0 + terrain.chunkSize, quads);
+
+            TerrainChunk chunk;
+            chunk.gridX = x0;
+            chunk.gridZ = z0;
+            chunk.baseVertex = (GLint)terrain.chunks.size() * chunkVertices;
+            chunk.pattern = FindOrAddPattern(terrain.patterns, x1 - x0, z1 - z0);
+            chunk.boundsMin = glm::vec3(x0 * terrain.spacing, 0.0f, z0 * terrain.spacing);
+            chunk.boundsMax = glm::vec3(x1 * terrain.spacing, 0.0f, z1 * terrain.spacing);
+
+            terrain.chunks.push_back(chunk);
+        }
+    }
+
+    // Height range covers the shared edge row/column too
+    ParallelFor(0, (int)terrain.chunks.size(), terrain.generationThreads, [&](int first, int last)
+    {
+        for (int c = first; c < last; c++)
+        {
+            TerrainChunk& chunk = terrain.chunks[c];
+            int x1 = chunk.gridX + terrain.patterns[chunk.pattern].width;
+            int z1 = chunk.gridZ + terrain.patterns[chunk.pattern].height;
+
+            float minY = heights[chunk.gridZ * terrain.renderDist + chunk.gridX];
+            float maxY = minY;
+
+            for (int z = chunk.gridZ; z <= z1; z++)
+            {
+                for (int x = chunk.gridX; x <= x1; x++)
+                {
+                    float y = heights[z * terrain.renderDist + x];
+                    minY = std::min(minY, y);
+                    maxY = std::max(maxY, y);
+                }
+            }
+
+            chunk.boundsMin.y = minY;
+            chunk.boundsMax.y = maxY;
+        }
+    });
+
+    // Grid vertex behind each chunk slot. Clipped chunks on the far edges repeat
+    // the last row/column in the slots their pattern never references.
+    const int slotCount = (int)terrain.chunks.size() * chunkVertices;
+    auto slotGridIndex = [&](int slot)
+    {
+        const TerrainChunk& chunk = terrain.chunks[slot / chunkVertices];
+        int local = slot % chunkVertices;
+        int x = std::min(chunk.gridX + local % pitch, quads);
+        int z = std::min(chunk.gridZ + local / pitch, quads);
+        return z * terrain.renderDist + x;
+    };
+
     // Upload
     glGenVertexArrays(1, &terrain.VAO);
     glGenBuffers(1, &terrain.VBO);
-    glGenBuffers(1, &terrain.EBO);
 
     glBindVertexArray(terrain.VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, terrain.VBO);
-    glBufferData(GL_ARRAY_BUFFER,
-        vertices.size() * sizeof(GLfloat),
-        vertices.data(),
-        GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrain.EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-        indices.size() * sizeof(GLuint),
-        indices.data(),
-        GL_STATIC_DRAW);
+    if (terrain.vertexFormat == TerrainVertexFormat::Compact)
+    {
+        // One normalised 16-bit height per vertex - x/z come back from gl_VertexID in terrain.vert
+        terrain.heightMin = terrain.chunks[0].boundsMin.y;
+        float heightMax = terrain.chunks[0].boundsMax.y;
+        for (const TerrainChunk& chunk : terrain.chunks)
+        {
+            terrain.heightMin = std::min(terrain.heightMin, chunk.boundsMin.y);
+            heightMax = std::max(heightMax, chunk.boundsMax.y);
+        }
+        terrain.heightRange = std::max(heightMax - terrain.heightMin, 1e-6f);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+        std::vector<GLushort> packed(slotCount);
+        ParallelFor(0, slotCount, terrain.generationThreads, [&](int first, int last)
+        {
+            for (int i = first; i < last; i++)
+            {
+                float t = (heights[slotGridIndex(i)] - terrain.heightMin) / terrain.heightRange;
+                packed[i] = (GLushort)(glm::clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f);
+            }
+        });
+
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(GLushort), packed.data(), GL_STATIC_DRAW);
+        terrain.vertexBytes = packed.size() * sizeof(GLushort);
+
+        glVertexAttribPointer(3, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(GLushort), (void*)0);
+        glEnableVertexAttribArray(3);
+    }
+    else
+    {
+        std::vector<GLfloat> vertices(slotCount * 6);
+        ParallelFor(0, slotCount, terrain.generationThreads, [&](int first, int last)
+        {
+            for (int i = first; i < last; i++)
+            {
+                int v = i * 6;
+                int grid = slotGridIndex(i);
+
+                vertices[v + 0] = (grid % terrain.renderDist) * terrain.spacing;
+                vertices[v + 1] = heights[grid];
+                vertices[v + 2] = (grid / terrain.renderDist) * terrain.spacing;
+
+                vertices[v + 3] = TERRAIN_SAND_COLOUR.x;
+                vertices[v + 4] = TERRAIN_SAND_COLOUR.y;
+                vertices[v + 5] = TERRAIN_SAND_COLOUR.z;
+            }
+        });
+
+        glBufferData(GL_ARRAY_BUFFER,
+            vertices.size() * sizeof(GLfloat),
+            vertices.data(),
+            GL_STATIC_DRAW);
+        terrain.vertexBytes = vertices.size() * sizeof(GLfloat);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+            (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+
+    // Morphing reads the heights around each vertex, so the grid goes up as a
+    // texture as well - packed the same way as the vertices
+    if (terrain.useLod && terrain.lodMorph)
+        UploadMorphHeights(terrain, heights);
 
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-        (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // Indices come from the buffer shared by every terrain with this chunk size
+    AcquireSharedIndices(terrain);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrain.EBO);
 
     glBindVertexArray(0);
 }
 
 
-void DrawTerrain(const TerrainInstance& terrain)
+TerrainUniforms FindTerrainUniforms(const ShaderProgram& program)
 {
+    TerrainUniforms uniforms;
+    uniforms.model = FindUniform(program, "modelIn");
+    uniforms.terrainMode = FindUniform(program, "terrainMode");
+
+    uniforms.chunkSize = FindUniform(program, "chunkSize");
+    uniforms.chunksPerSide = FindUniform(program, "chunksPerSide");
+    uniforms.gridSpacing = FindUniform(program, "gridSpacing");
+    uniforms.heightMin = FindUniform(program, "heightMin");
+    uniforms.heightRange = FindUniform(program, "heightRange");
+
+    uniforms.heightMap = FindUniform(program, "heightMap");
+    uniforms.heightMapSpacing = FindUniform(program, "heightMapSpacing");
+    uniforms.clipmapOrigin = FindUniform(program, "clipmapOrigin");
+    uniforms.clipmapOffset = FindUniform(program, "clipmapOffset");
+    uniforms.clipmapSpacing = FindUniform(program, "clipmapSpacing");
+    uniforms.clipmapSize = FindUniform(program, "clipmapSize");
+    uniforms.sandColour = FindUniform(program, "sandColour");
+
+    uniforms.lodMorph = FindUniform(program, "lodMorph");
+    uniforms.lodDistance = FindUniform(program, "lodDistance");
+    uniforms.lodLevels = FindUniform(program, "lodLevels");
+    uniforms.lodCamera = FindUniform(program, "lodCamera");
+    return uniforms;
+}
+
+TerrainDrawStats DrawTerrain(TerrainInstance& terrain, const ShaderProgram& shader, const TerrainUniforms& uniforms,
+    const glm::mat4& mvp, const glm::vec3& cameraLocal)
+{
+    if (terrain.mode == TerrainMode::Clipmap)
+        return DrawClipmap(terrain, shader, uniforms, cameraLocal);
+
+    bool morph = terrain.useLod && terrain.lodMorph && terrain.heightMap != 0;
+    SetUniform(shader, uniforms.lodMorph, morph ? 1 : 0);
+
+    if (morph)
+    {
+        SetUniform(shader, uniforms.heightMap, 0);
+        SetUniform(shader, uniforms.gridSpacing, terrain.spacing);
+        SetUniform(shader, uniforms.heightMin, terrain.heightMin);
+        SetUniform(shader, uniforms.heightRange, terrain.heightRange);
+        SetUniform(shader, uniforms.lodDistance, terrain.lodDistance);
+        SetUniform(shader, uniforms.lodLevels, terrain.lodLevels);
+        SetUniform(shader, uniforms.lodCamera, cameraLocal);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, terrain.heightMap);
+    }
+
+    if (terrain.vertexFormat == TerrainVertexFormat::Compact)
+    {
+        SetUniform(shader, uniforms.terrainMode, 2);
+        SetUniform(shader, uniforms.chunkSize, terrain.chunkSize);
+        SetUniform(shader, uniforms.chunksPerSide, terrain.chunksPerSide);
+        SetUniform(shader, uniforms.gridSpacing, terrain.spacing);
+        SetUniform(shader, uniforms.heightMin, terrain.heightMin);
+        SetUniform(shader, uniforms.heightRange, terrain.heightRange);
+        SetUniform(shader, uniforms.sandColour, TERRAIN_SAND_COLOUR);
+    }
+    else
+    {
+        SetUniform(shader, uniforms.terrainMode, 0);
+    }
+
+    TerrainDrawStats stats;
+    stats.chunksTotal = (int)terrain.chunks.size();
+
+    const int side = terrain.chunksPerSide;
+    std::vector<int>& levels = terrain.chunkLevels;
+    levels.assign(terrain.chunks.size(), 0);
+
+    if (terrain.useLod)
+    {
+        for (size_t i = 0; i < terrain.chunks.size(); i++)
+            levels[i] = SelectLodLevel(terrain, terrain.chunks[i], cameraLocal);
+
+        // Stitching only covers a one-level step, so pull any chunk that is
+        // two or more levels coarser than a neighbour back towards it
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (int cz = 0; cz < side; cz++)
+            {
+                for (int cx = 0; cx < side; cx++)
+                {
+                    int& level = levels[cz * side + cx];
+                    int limit = level;
+
+                    if (cz > 0)        limit = std::min(limit, levels[(cz - 1) * side + cx] + 1);
+                    if (cz + 1 < side) limit = std::min(limit, levels[(cz + 1) * side + cx] + 1);
+                    if (cx > 0)        limit = std::min(limit, levels[cz * side + cx - 1] + 1);
+                    if (cx + 1 < side) limit = std::min(limit, levels[cz * side + cx + 1] + 1);
+
+                    if (limit < level)
+                    {
+                        level = limit;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    // mvp includes the model matrix, so the planes land in the same local space as the chunk bounds
+    Frustum frustum = ExtractFrustum(mvp);
+
     glBindVertexArray(terrain.VAO);
 
-    int indexCount =
-        (terrain.renderDist - 1) *
-        (terrain.renderDist - 1) * 6;
+    for (int cz = 0; cz < side; cz++)
+    {
+        for (int cx = 0; cx < side; cx++)
+        {
+            const TerrainChunk& chunk = terrain.chunks[cz * side + cx];
+
+            if (!FrustumIntersectsAABB(frustum, chunk.boundsMin, chunk.boundsMax))
+                continue;
+
+            int level = levels[cz * side + cx];
+            int mask = 0;
+
+            if (cz > 0        && levels[(cz - 1) * side + cx] > level) mask |= TERRAIN_EDGE_NORTH;
+            if (cz + 1 < side && levels[(cz + 1) * side + cx] > level) mask |= TERRAIN_EDGE_SOUTH;
+            if (cx > 0        && levels[cz * side + cx - 1] > level)   mask |= TERRAIN_EDGE_WEST;
+            if (cx + 1 < side && levels[cz * side + cx + 1] > level)   mask |= TERRAIN_EDGE_EAST;
+
+            const TerrainIndexRange& range = terrain.patterns[chunk.pattern].ranges[level][mask];
+
+            glDrawElementsBaseVertex(GL_TRIANGLES, range.count, GL_UNSIGNED_SHORT,
+                (void*)(range.offset * sizeof(GLushort)), chunk.baseVertex);
+
+            stats.chunksDrawn++;
+            stats.trianglesSubmitted += range.count / 3;
+        }
+    }
 
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
+
+    if (morph)
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+    return stats;
 }
 
 
 
-float TerrainHalfSize() {
-	return (TERRAIN_RENDER_DIST * TERRAIN_SPACING) / 2.0f; 
+void CleanupTerrain(TerrainInstance& terrain)
+{
+    ReleaseSharedIndices(terrain);
+
+    glDeleteVertexArrays(1, &terrain.VAO);
+    glDeleteBuffers(1, &terrain.VBO);
+    glDeleteTextures(1, &terrain.heightMap);
+
+    glDeleteVertexArrays(1, &terrain.clipmap.VAO);
+    glDeleteBuffers(1, &terrain.clipmap.VBO);
+    glDeleteBuffers(1, &terrain.clipmap.EBO);
+
+    terrain.VAO = terrain.VBO = terrain.EBO = terrain.heightMap = 0;
+    terrain.clipmap = TerrainClipmap();
+
+    std::vector<TerrainChunk>().swap(terrain.chunks);
+    std::vector<TerrainPattern>().swap(terrain.patterns);
+    std::vector<int>().swap(terrain.chunkLevels);
+
+    terrain.vertexBytes = terrain.indexBytes = terrain.textureBytes = 0;
+}
+
+TerrainMemory GetTerrainMemory(const TerrainInstance& terrain)
+{
+    TerrainMemory memory;
+
+    memory.cpuBytes = sizeof(TerrainInstance)
+        + terrain.chunks.capacity() * sizeof(TerrainChunk)
+        + terrain.patterns.capacity() * sizeof(TerrainPattern)
+        + terrain.chunkLevels.capacity() * sizeof(int);
+
+    memory.vertexBytes = terrain.vertexBytes;
+    memory.indexBytes = terrain.indexBytes;
+    memory.textureBytes = terrain.textureBytes;
+    memory.gpuBytes = memory.vertexBytes + memory.indexBytes + memory.textureBytes;
+
+    return memory;
+}
+
+void PrintTerrainMemory(const char* name, const TerrainInstance& terrain)
+{
+    const double MB = 1024.0 * 1024.0;
+    TerrainMemory memory = GetTerrainMemory(terrain);
+
+    std::cout << "Terrain '" << name << "': CPU " << memory.cpuBytes / MB << " MB, GPU "
+        << memory.gpuBytes / MB << " MB (vertices " << memory.vertexBytes / MB
+        << ", indices " << memory.indexBytes / MB
+        << ", textures " << memory.textureBytes / MB << ")\n";
+}
+
+TerrainVertexCacheStats MeasureTerrainVertexCache(const TerrainInstance& terrain, TerrainIndexOrder order, int cacheSize)
+{
+    TerrainVertexCacheStats stats;
+    if (terrain.mode != TerrainMode::Mesh)
+        return stats;
+
+    // Every chunk of a pattern behaves the same, so simulate each pattern once and weight it
+    std::vector<int> chunkCounts(terrain.patterns.size(), 0);
+    for (const TerrainChunk& chunk : terrain.chunks)
+        chunkCounts[chunk.pattern]++;
+
+    const int pitch = terrain.chunkSize + 1;
+
+    for (size_t p = 0; p < terrain.patterns.size(); p++)
+    {
+        const TerrainPattern& pattern = terrain.patterns[p];
+
+        std::vector<GLushort> indices;
+        BuildPatternIndices(pitch, pattern.width, pattern.height, 0, 0, order, indices);
+
+        // Each chunk is its own draw, so the cache starts cold
+        std::vector<int> fifo(std::max(cacheSize, 1), -1);
+        size_t next = 0;
+        size_t misses = 0;
+
+        for (GLushort index : indices)
+        {
+            if (std::find(fifo.begin(), fifo.end(), (int)index) != fifo.end())
+                continue;
+
+            fifo[next] = index;
+            next = (next + 1) % fifo.size();
+            misses++;
+        }
+
+        stats.triangles += chunkCounts[p] * (indices.size() / 3);
+        stats.vertices += chunkCounts[p] * (size_t)(pattern.width + 1) * (pattern.height + 1);
+        stats.cacheMisses += chunkCounts[p] * misses;
+    }
+
+    if (stats.triangles > 0)
+    {
+        stats.acmr = (float)stats.cacheMisses / stats.triangles;
+        stats.atvr = (float)stats.cacheMisses / stats.vertices;
+    }
+
+    return stats;
+}
+
+void PrintTerrainVertexCache(const char* name, const TerrainInstance& terrain)
+{
+    if (terrain.mode != TerrainMode::Mesh)
+        return;
+
+    TerrainVertexCacheStats rows = MeasureTerrainVertexCache(terrain, TerrainIndexOrder::Rows);
+    TerrainVertexCacheStats strips = MeasureTerrainVertexCache(terrain, TerrainIndexOrder::ColumnStrips);
+
+    std::cout << "Terrain '" << name << "' vertex cache (" << TERRAIN_VERTEX_CACHE_SIZE << " entry FIFO, "
+        << rows.triangles << " triangles): rows ACMR " << rows.acmr << " ATVR " << rows.atvr
+        << ", column strips ACMR " << strips.acmr << " ATVR " << strips.atvr
+        << (terrain.indexOrder == TerrainIndexOrder::ColumnStrips ? " (in use)" : " (rows in use)") << "\n";
+}
+
+float TerrainHalfSize(const TerrainInstance& terrain) {
+	return (terrain.renderDist * terrain.spacing) / 2.0f; 
 }
\ No newline at end of file
@@ -2,14 +2,99 @@
 
 #include <GLAD/glad.h>
 #include <glm/glm.hpp>
-#include <learnOpenGL/shader_m.h>
 
-struct TerrainInstance
+#include "shaderprogram.h"
+
+#include <vector>
+
+constexpr int TERRAIN_MAX_LOD_LEVELS = 7;   // stride 1 .. 64
+
+// Post-transform vertex cache the index order is tuned for (FIFO entries).
+// A strip N cells wide keeps N + 1 vertices of the row above alive, so the
+// cache has to hold two rows of the strip.
+constexpr int TERRAIN_VERTEX_CACHE_SIZE = 24;
+constexpr int TERRAIN_STRIP_CELLS = TERRAIN_VERTEX_CACHE_SIZE / 2 - 1;
+
+// Edges of a chunk that border a coarser LOD neighbour
+enum TerrainEdge
+{
+    TERRAIN_EDGE_NORTH = 1,   // z = 0 side
+    TERRAIN_EDGE_SOUTH = 2,
+    TERRAIN_EDGE_WEST = 4,    // x = 0 side
+    TERRAIN_EDGE_EAST = 8
+};
+
+struct TerrainIndexRange
+{
+    GLsizei offset = 0;    // first index in the EBO
+    GLsizei count = 0;
+};
+
+// Index patterns for one chunk size, for every LOD level and seam combination.
+// Indices are 16-bit and relative to the chunk's first vertex.
+struct TerrainPattern
+{
+    int width;             // quads
+    int height;
+    TerrainIndexRange ranges[TERRAIN_MAX_LOD_LEVELS][16];
+};
+
+// One square block of the grid.
+// Bounds are in terrain-local space (before the model matrix).
+struct TerrainChunk
+{
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+
+    int gridX;             // grid vertex at the chunk's top-left corner
+    int gridZ;
+
+    GLint baseVertex;      // first vertex of the chunk's own (chunkSize + 1)^2 block
+    int pattern;           // index into TerrainInstance::patterns
+};
+
+enum class TerrainMode
+{
+    Mesh,       // whole grid baked into the VBO, drawn as chunks
+    Clipmap     // camera-centred rings, heights sampled from heightMap
+};
+
+// Mesh mode vertex layout
+enum class TerrainVertexFormat
+{
+    Full,       // 24 bytes: position + colour floats
+    Compact     // 2 bytes: normalised 16-bit height, x/z rebuilt from gl_VertexID
+};
+
+// Mesh mode triangle order inside each index pattern
+enum class TerrainIndexOrder
+{
+    Rows,           // left to right across the whole chunk, then down
+    ColumnStrips    // TERRAIN_STRIP_CELLS wide strips, each walked top to bottom
+};
+
+// Meshes shared by every clipmap level, in cell units
+struct TerrainClipmap
 {
     GLuint VAO = 0;
     GLuint VBO = 0;
     GLuint EBO = 0;
 
+    TerrainIndexRange block;           // level 0, solid
+    TerrainIndexRange ring;            // levels 1+, hole for the level inside
+    TerrainIndexRange trimVertical;    // 1 cell wide strip down one side of the hole
+    TerrainIndexRange trimHorizontal;  // 1 cell tall strip across the other
+};
+
+struct TerrainInstance
+{
+    TerrainMode mode = TerrainMode::Mesh;
+    TerrainVertexFormat vertexFormat = TerrainVertexFormat::Full;
+
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLuint EBO = 0;        // mesh mode: shared by every terrain with the same chunkSize
+
     int renderDist;        // grid resolution
     float spacing;         // vertex spacing
 
@@ -18,12 +103,127 @@ struct TerrainInstance
     float bowlHeight;
 
     glm::vec2 center;      // centre of bowl in grid space
+
+    // Dunes - ridged FastNoiseLite noise on top of the bowl, off while duneHeight is 0
+    float duneHeight = 0.0f;       // crest height above the bowl surface
+    float duneWavelength = 48.0f;  // world units between crests
+    float duneStretch = 3.0f;      // crests run this many times longer along x than across
+    int duneOctaves = 3;
+    int duneSeed = 1337;
+
+    int generationThreads = 0;     // InitialiseTerrain workers: 0 = one per core, 1 = serial
+
+    int chunkSize = 64;    // quads per chunk side, up to 255 for 16-bit indices
+    int chunksPerSide = 0;
+    std::vector<TerrainChunk> chunks;
+    std::vector<TerrainPattern> patterns;      // ranges into the shared EBO
+    TerrainIndexOrder indexOrder = TerrainIndexOrder::ColumnStrips;
+
+    // Level of detail - off draws every chunk at full density. chunkSize should
+    // be a multiple of the coarsest stride, so every level's lattice lines up
+    // across chunks.
+    bool useLod = false;
+    bool lodMorph = true;          // morph heights towards the next level instead of popping
+    int lodLevels = 5;             // <= TERRAIN_MAX_LOD_LEVELS, stride doubles per level
+    float lodDistance = 160.0f;    // full density inside this distance, doubling per level after
+    std::vector<int> chunkLevels;  // DrawTerrain's per-chunk levels, reused every frame
+
+    // Compact format only - packed height h maps back to heightMin + h * heightRange
+    float heightMin = 0.0f;
+    float heightRange = 1.0f;
+
+    // Clipmap mode, and mesh mode with lodMorph (packed like the vertices there)
+    GLuint heightMap = 0;          // one texel per grid vertex
+
+    // Clipmap mode only
+    int clipmapLevels = 5;         // spacing doubles per level
+    int clipmapSize = 64;          // cells per level side, multiple of 4
+    TerrainClipmap clipmap;
+
+    // Bytes handed to GL at upload - the CPU-side copies are freed once uploaded.
+    // In mesh mode indexBytes is the shared buffer, so it is not per instance.
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    size_t textureBytes = 0;
 };
 
+// What the last DrawTerrain call actually sent to the GPU
+struct TerrainDrawStats
+{
+    int chunksDrawn = 0;
+    int chunksTotal = 0;
+    GLsizei trianglesSubmitted = 0;
+};
+
+// FIFO vertex cache simulation over every chunk at full density.
+// ACMR = vertex shader runs per triangle (0.5 is ideal for a grid),
+// ATVR = vertex shader runs per unique vertex (1.0 is ideal).
+struct TerrainVertexCacheStats
+{
+    size_t triangles = 0;
+    size_t vertices = 0;       // unique vertices referenced
+    size_t cacheMisses = 0;    // vertex shader invocations
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+// Memory held per instance
+struct TerrainMemory
+{
+    size_t cpuBytes = 0;       // the instance plus its chunk and pattern tables
+    size_t gpuBytes = 0;       // sum of the three below
+
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    size_t textureBytes = 0;
+};
+
+// terrain.vert's uniforms, looked up once per program
+struct TerrainUniforms
+{
+    UniformHandle model = UNIFORM_NONE;
+    UniformHandle terrainMode = UNIFORM_NONE;
+
+    UniformHandle chunkSize = UNIFORM_NONE;
+    UniformHandle chunksPerSide = UNIFORM_NONE;
+    UniformHandle gridSpacing = UNIFORM_NONE;
+    UniformHandle heightMin = UNIFORM_NONE;
+    UniformHandle heightRange = UNIFORM_NONE;
+
+    UniformHandle heightMap = UNIFORM_NONE;
+    UniformHandle heightMapSpacing = UNIFORM_NONE;
+    UniformHandle clipmapOrigin = UNIFORM_NONE;
+    UniformHandle clipmapOffset = UNIFORM_NONE;
+    UniformHandle clipmapSpacing = UNIFORM_NONE;
+    UniformHandle clipmapSize = UNIFORM_NONE;
+    UniformHandle sandColour = UNIFORM_NONE;
+
+    UniformHandle lodMorph = UNIFORM_NONE;
+    UniformHandle lodDistance = UNIFORM_NONE;
+    UniformHandle lodLevels = UNIFORM_NONE;
+    UniformHandle lodCamera = UNIFORM_NONE;
+};
+
+TerrainUniforms FindTerrainUniforms(const ShaderProgram& program);
+
 void InitialiseTerrain(TerrainInstance& terrain, bool inverted);
 
-void DrawTerrain(const TerrainInstance& terrain);
+// mvp is projection * view * model for this terrain - chunks outside its frustum are skipped.
+// cameraLocal is the camera in terrain-local space, used to pick each chunk's LOD
+// and to centre the clipmap. Sets the terrain uniforms on the (already bound) shader.
+TerrainDrawStats DrawTerrain(TerrainInstance& terrain, const ShaderProgram& shader, const TerrainUniforms& uniforms,
+    const glm::mat4& mvp, const glm::vec3& cameraLocal);
+
+// Releases the instance's GL objects and tables
+void CleanupTerrain(TerrainInstance& terrain);
+
+TerrainMemory GetTerrainMemory(const TerrainInstance& terrain);
+void PrintTerrainMemory(const char* name, const TerrainInstance& terrain);
 
-void CleanupTerrain();
+// Mesh mode only. Rebuilds the level 0 patterns in the given order on the CPU,
+// so the two orders can be compared without touching the GPU buffers.
+TerrainVertexCacheStats MeasureTerrainVertexCache(const TerrainInstance& terrain, TerrainIndexOrder order,
+    int cacheSize = TERRAIN_VERTEX_CACHE_SIZE);
+void PrintTerrainVertexCache(const char* name, const TerrainInstance& terrain);
 
-float TerrainHalfSize();
\ No newline at end of file
+float TerrainHalfSize(const TerrainInstance& terrain);
@@ -0,0 +1,425 @@
+#include "texturecache.h"
+#include "ktx2.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+static std::string CanonicalPath(const std::string& filename)
+{
+    std::string path = filename;
+
+#ifdef _WIN32
+    char resolved[_MAX_PATH];
+    if (_fullpath(resolved, filename.c_str(), _MAX_PATH) != nullptr)
+        path = resolved;
+
+    // NTFS is case-insensitive
+    std::replace(path.begin(), path.end(), '\\', '/');
+    std::transform(path.begin(), path.end(), path.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+#else
+    char resolved[PATH_MAX];
+    if (realpath(filename.c_str(), resolved) != nullptr)
+        path = resolved;
+#endif
+
+    return path;
+}
+
+// FNV-1a over the size and bytes of the file
+static uint64_t ContentHash(const AssetFile& file)
+{
+    uint64_t hash = 14695981039346656037ull;
+    uint64_t size = file.size;
+
+    for (size_t i = 0; i < sizeof(size); i++)
+    {
+        hash ^= (unsigned char)(size >> (i * 8));
+        hash *= 1099511628211ull;
+    }
+
+    for (size_t i = 0; i < file.size; i++)
+    {
+        hash ^= file.data[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static std::string CookedPath(const std::string& path)
+{
+    return path + ".ktx2";
+}
+
+void InitialiseTextureCache(TextureCache& cache, bool highQuality)
+{
+    // BPTC (BC7) is core since 4.2, but S3TC is still an extension
+    bool s3tc = false;
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+    for (GLint i = 0; i < count && !s3tc; i++)
+    {
+        const char* name = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        s3tc = name != nullptr && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0;
+    }
+
+    cache.compress = s3tc;
+    cache.highQuality = highQuality && GLAD_GL_VERSION_4_2;
+
+    if (!cache.compress)
+        std::cout << "No S3TC texture compression - textures are uploaded uncompressed\n";
+}
+
+// Whether a cooked file is in the format this cache would cook now
+static bool WantedCompression(const TextureCache& cache, TextureCompression format)
+{
+    if (cache.highQuality)
+        return format == TextureCompression::BC7;
+    return format == TextureCompression::BC1 || format == TextureCompression::BC3;
+}
+
+static TextureCompression ChooseCompression(const TextureCache& cache, const unsigned char* rgba, int width, int height)
+{
+    if (cache.highQuality)
+        return TextureCompression::BC7;
+
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        if (rgba[i * 4 + 3] != 255)
+            return TextureCompression::BC3;
+    }
+
+    return TextureCompression::BC1;
+}
+
+static size_t CompressedBytes(const CompressedImage& image)
+{
+    size_t bytes = 0;
+    for (const CompressedLevel& level : image.levels)
+        bytes += level.size;
+    return bytes;
+}
+
+// Maps <image>.ktx2 if it was cooked from these bytes in the wanted format.
+// The mapping stays open in the entry until the upload.
+static bool LoadCookedTexture(const TextureCache& cache, CachedTexture& texture)
+{
+    if (!OpenAssetFile(CookedPath(texture.path), texture.cookedFile))
+        return false;
+
+    uint64_t sourceHash = 0;
+    if (ReadKtx2(texture.cookedFile, texture.compressed, sourceHash) && sourceHash == texture.contentHash
+        && WantedCompression(cache, texture.compressed.format))
+        return true;
+
+    CloseAssetFile(texture.cookedFile);
+    texture.compressed = CompressedImage();
+    return false;
+}
+
+// Decodes the source, and compresses and cooks it if the cache compresses.
+// False if the image cannot be decoded.
+static bool DecodeTexture(const TextureCache& cache, CachedTexture& texture, const AssetFile& source)
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    // Compression wants RGBA whatever the image has; the uncompressed path
+    // uploads what it has
+    int wanted = cache.compress ? 4 : 0;
+    unsigned char* pixels = stbi_load_from_memory(source.data, (int)source.size, &width, &height, &channels, wanted);
+    if (pixels == nullptr)
+        return false;
+
+    texture.width = width;
+    texture.height = height;
+    texture.channels = cache.compress ? 4 : channels;
+
+    if (cache.compress)
+    {
+        TextureCompression format = ChooseCompression(cache, pixels, width, height);
+        CompressTexture(pixels, width, height, format, texture.compressed, texture.cookedData);
+
+        // Without the cooked file the next start just compresses again, so
+        // this can fail quietly
+        WriteKtx2(CookedPath(texture.path), texture.compressed, texture.cookedData.data(), texture.contentHash);
+        texture.bytes = texture.cookedData.size();
+    }
+    else
+    {
+        texture.pixels.assign(pixels, pixels + (size_t)width * height * channels);
+        texture.bytes = texture.pixels.size();
+    }
+
+    stbi_image_free(pixels);
+    return true;
+}
+
+int RequestTexture(TextureCache& cache, const std::string& filename)
+{
+    std::string path = CanonicalPath(filename);
+
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.stats.requests++;
+
+        auto found = cache.byPath.find(path);
+        if (found != cache.byPath.end())
+        {
+            cache.stats.pathHits++;
+            return found->second;
+        }
+    }
+
+    AssetFile file;
+    if (!OpenAssetFile(path, file))
+    {
+        std::cout << "Texture failed to load at path: " << filename << "\n";
+        return -1;
+    }
+
+    uint64_t hash = ContentHash(file);
+    int entry = -1;
+    CachedTexture* texture = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+
+        // Another thread may have claimed the path while this one was hashing
+        auto byPath = cache.byPath.find(path);
+        auto byContent = cache.byContent.find(hash);
+
+        if (byPath != cache.byPath.end())
+        {
+            cache.stats.pathHits++;
+            entry = byPath->second;
+        }
+        else if (byContent != cache.byContent.end())
+        {
+            cache.stats.contentHits++;
+            entry = byContent->second;
+            cache.byPath[path] = entry;
+        }
+        else
+        {
+            entry = (int)cache.entries.size();
+            cache.entries.push_back(std::unique_ptr<CachedTexture>(new CachedTexture()));
+            texture = cache.entries.back().get();
+            texture->path = path;
+            texture->contentHash = hash;
+
+            cache.byPath[path] = entry;
+            cache.byContent[hash] = entry;
+        }
+    }
+
+    // Only the thread that created the entry decodes or loads it - outside
+    // the lock, so other requests carry on meanwhile. Nothing else touches
+    // the entry until decoded is set.
+    if (texture != nullptr)
+    {
+        bool cooked = cache.compress && LoadCookedTexture(cache, *texture);
+        bool loaded = cooked || DecodeTexture(cache, *texture, file);
+
+        if (cooked)
+        {
+            texture->width = texture->compressed.levels[0].width;
+            texture->height = texture->compressed.levels[0].height;
+            texture->channels = 4;
+            texture->bytes = CompressedBytes(texture->compressed);
+        }
+
+        std::lock_guard<std::mutex> lock(cache.mutex);
+
+        if (cooked)
+        {
+            cache.stats.cookedLoads++;
+        }
+        else
+        {
+            cache.stats.decodes++;
+            if (loaded && cache.compress)
+                cache.stats.compressions++;
+        }
+
+        if (!loaded)
+            std::cout << "Texture failed to load at path: " << filename << "\n";
+
+        texture->decoded = true;
+        cache.decodedChanged.notify_all();
+    }
+
+    CloseAssetFile(file);
+    return entry;
+}
+
+static void SetTextureParameters()
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+static GLuint UploadTexture(const CachedTexture& texture)
+{
+    if (texture.pixels.empty())
+        return 0;
+
+    GLenum format = GL_RGBA;
+    if (texture.channels == 1)      format = GL_RED;
+    else if (texture.channels == 3) format = GL_RGB;
+
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, texture.width, texture.height, 0, format, GL_UNSIGNED_BYTE, texture.pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    SetTextureParameters();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return id;
+}
+
+// Every level as stored - the chain is already complete
+static GLuint UploadCompressedTexture(const CachedTexture& texture)
+{
+    if (texture.compressed.levels.empty())
+        return 0;
+
+    const unsigned char* data = texture.cookedFile.data != nullptr ? texture.cookedFile.data : texture.cookedData.data();
+    GLenum format = CompressedInternalFormat(texture.compressed.format);
+
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+
+    for (size_t level = 0; level < texture.compressed.levels.size(); level++)
+    {
+        const CompressedLevel& compressed = texture.compressed.levels[level];
+        glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, format, compressed.width, compressed.height, 0,
+            (GLsizei)compressed.size, data + compressed.offset);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture.compressed.levels.size() - 1);
+    SetTextureParameters();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return id;
+}
+
+// Drops whatever was kept for the upload
+static void FreeTextureSource(CachedTexture& texture)
+{
+    std::vector<unsigned char>().swap(texture.pixels);
+    std::vector<unsigned char>().swap(texture.cookedData);
+    texture.compressed = CompressedImage();
+    CloseAssetFile(texture.cookedFile);
+}
+
+GLuint AcquireTexture(TextureCache& cache, int entry)
+{
+    if (entry < 0)
+        return 0;
+
+    std::unique_lock<std::mutex> lock(cache.mutex);
+    CachedTexture& texture = *cache.entries[entry];
+
+    // Only the context thread uploads, so after the wait nothing else touches
+    // the pixels - the lock can go for the upload itself
+    cache.decodedChanged.wait(lock, [&]() { return texture.decoded; });
+
+    if (texture.id == 0 && (!texture.pixels.empty() || !texture.compressed.levels.empty()))
+    {
+        lock.unlock();
+        GLuint id = texture.compressed.levels.empty() ? UploadTexture(texture) : UploadCompressedTexture(texture);
+        lock.lock();
+
+        texture.id = id;
+        cache.byTexture[id] = entry;
+        cache.stats.uploads++;
+        cache.stats.uploadedBytes += texture.bytes;
+
+        FreeTextureSource(texture);
+    }
+    else if (texture.id != 0)
+    {
+        cache.stats.sharedBytes += texture.bytes;
+    }
+
+    if (texture.id != 0)
+        texture.references++;
+
+    return texture.id;
+}
+
+void ReleaseTexture(TextureCache& cache, GLuint id)
+{
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    auto found = cache.byTexture.find(id);
+    if (found == cache.byTexture.end())
+        return;
+
+    int entry = found->second;
+    CachedTexture& texture = *cache.entries[entry];
+    if (--texture.references > 0)
+        return;
+
+    glDeleteTextures(1, &texture.id);
+    cache.byTexture.erase(found);
+
+    // Forget the keys too, so a later request decodes afresh
+    for (auto it = cache.byPath.begin(); it != cache.byPath.end();)
+        it = it->second == entry ? cache.byPath.erase(it) : std::next(it);
+    cache.byContent.erase(texture.contentHash);
+
+    // Retired, not reset: it stays decoded with no texture and nothing to
+    // upload, so an index still held elsewhere acquires 0 rather than waiting
+    // for a decode no thread will ever do
+    FreeTextureSource(texture);
+    texture.id = 0;
+    texture.bytes = 0;
+}
+
+void PrintTextureCacheStats(TextureCache& cache)
+{
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    const TextureCacheStats& stats = cache.stats;
+
+    std::cout << "Textures: " << stats.requests << " requested, " << stats.cookedLoads << " loaded cooked, "
+        << stats.decodes << " decoded (" << stats.compressions << " compressed), "
+        << stats.uploads << " uploaded (" << stats.pathHits << " shared by path, " << stats.contentHits
+        << " by content), " << stats.uploadedBytes / (1024 * 1024) << " MB uploaded, "
+        << stats.sharedBytes / (1024 * 1024) << " MB not duplicated\n";
+}
+
+void CleanupTextureCache(TextureCache& cache)
+{
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    for (const auto& texture : cache.byTexture)
+        glDeleteTextures(1, &texture.first);
+
+    // Entries requested but never acquired may still hold a mapping
+    for (const auto& texture : cache.entries)
+        FreeTextureSource(*texture);
+
+    cache.entries.clear();
+    cache.byPath.clear();
+    cache.byContent.clear();
+    cache.byTexture.clear();
+    cache.stats = TextureCacheStats();
+}
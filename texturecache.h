@@ -0,0 +1,110 @@
+#pragma once
+
+#include "assetfile.h"
+#include "texturecompress.h"
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// TEXTURE CACHE
+//
+// One GL texture per distinct image, however many models use it. Images are
+// matched by canonical path first (absolute, with separators and - on
+// Windows - case normalised) and then by a hash of the file's bytes, so the
+// same image copied under another name is shared as well.
+//
+// Split the same way as model loading (modelloader.h):
+//   - RequestTexture (any thread) claims the image. The first request for it
+//     decodes; every later one, by either key, gets the same entry without
+//     decoding anything.
+//   - AcquireTexture (context thread) uploads the entry the first time -
+//     waiting for the decode if another thread is still on it - and counts a
+//     reference. ReleaseTexture drops it; the texture is deleted at zero.
+//
+// Where the driver has S3TC, textures are block compressed (texturecompress.h)
+// with their whole mip chain, and the result is cooked beside the image as
+// <image>.ktx2 (ktx2.h). A later request whose image still hashes the same
+// maps that file and uploads its levels straight from the mapping - no
+// PNG/JPEG decode, no compression and no glGenerateMipmap at startup:
+//   - colour with alpha BC3, or BC7 in high quality
+//   - opaque colour     BC1, or BC7 in high quality
+// Without S3TC images are decoded and uploaded uncompressed, as before.
+// -----------------------------------------------------------------------------
+
+struct CachedTexture
+{
+    std::string path;              // canonical path of the first request
+    uint64_t contentHash = 0;
+
+    bool decoded = false;          // pixels or compressed levels are final (neither if the decode failed)
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;   // uncompressed path, freed once uploaded
+
+    CompressedImage compressed;    // levels into cookedFile if it is open, else cookedData
+    AssetFile cookedFile;          // the .ktx2 mapping, closed once uploaded
+    std::vector<unsigned char> cookedData;   // levels compressed this run, freed once uploaded
+    size_t bytes = 0;              // what the upload hands to GL
+
+    GLuint id = 0;
+    int references = 0;
+};
+
+struct TextureCacheStats
+{
+    int requests = 0;
+    int pathHits = 0;              // same canonical path as an earlier request
+    int contentHits = 0;           // different path, identical bytes
+    int decodes = 0;               // PNG/JPEG decodes
+    int compressions = 0;          // of those, compressed and cooked to .ktx2
+    int cookedLoads = 0;           // mapped from an up-to-date .ktx2 instead
+    int uploads = 0;
+    size_t uploadedBytes = 0;      // compressed mip chains, or uncompressed level 0
+    size_t sharedBytes = 0;        // what the hits would have uploaded again
+};
+
+struct TextureCache
+{
+    bool compress = false;         // set by InitialiseTextureCache
+    bool highQuality = false;      // BC7 for colour
+
+    std::mutex mutex;
+    std::condition_variable decodedChanged;
+
+    std::vector<std::unique_ptr<CachedTexture>> entries;   // index = entry id, never reused
+    std::unordered_map<std::string, int> byPath;
+    std::unordered_map<uint64_t, int> byContent;
+    std::unordered_map<GLuint, int> byTexture;
+
+    TextureCacheStats stats;
+};
+
+// Context thread, before any request. Turns compression on if the driver can
+// sample BC1/BC3 (and BC7, for highQuality).
+void InitialiseTextureCache(TextureCache& cache, bool highQuality = false);
+
+// Any thread. Returns the entry for the file, decoding or loading its cooked
+// copy if this is the first request. -1 if the file cannot be opened.
+int RequestTexture(TextureCache& cache, const std::string& filename);
+
+// Context thread. The GL texture for a requested entry, with one more reference.
+// 0 for -1, an image that failed to decode or an entry whose texture was
+// released - a new request for the image makes a new entry.
+GLuint AcquireTexture(TextureCache& cache, int entry);
+
+// Context thread. Deletes the texture when its last reference goes.
+void ReleaseTexture(TextureCache& cache, GLuint texture);
+
+void PrintTextureCacheStats(TextureCache& cache);
+
+// Deletes every texture still referenced
+void CleanupTextureCache(TextureCache& cache);
@@ -0,0 +1,442 @@
+#include "texturecompress.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+size_t CompressedBlockBytes(TextureCompression format)
+{
+    switch (format)
+    {
+    case TextureCompression::BC1: return 8;
+    case TextureCompression::BC3: return 16;
+    case TextureCompression::BC7: return 16;
+    default:                      return 0;
+    }
+}
+
+GLenum CompressedInternalFormat(TextureCompression format)
+{
+    switch (format)
+    {
+    case TextureCompression::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureCompression::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TextureCompression::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default:                      return GL_NONE;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// ENDPOINTS
+// -----------------------------------------------------------------------------
+
+// Mean and unit principal axis of count points with channels components each
+// (power iteration on the covariance). The axis is zero for a flat block.
+static void PrincipalAxis(const float* points, int count, int channels, float* mean, float* axis)
+{
+    float covariance[4][4] = {};
+
+    for (int c = 0; c < channels; c++)
+    {
+        mean[c] = 0.0f;
+        for (int i = 0; i < count; i++)
+            mean[c] += points[i * channels + c];
+        mean[c] /= (float)count;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        for (int a = 0; a < channels; a++)
+        {
+            for (int b = 0; b < channels; b++)
+                covariance[a][b] += (points[i * channels + a] - mean[a]) * (points[i * channels + b] - mean[b]);
+        }
+    }
+
+    // Start from the row of the widest channel - never orthogonal to the axis
+    int widest = 0;
+    for (int c = 1; c < channels; c++)
+    {
+        if (covariance[c][c] > covariance[widest][widest])
+            widest = c;
+    }
+
+    for (int c = 0; c < channels; c++)
+        axis[c] = covariance[widest][c];
+
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = {};
+        float length = 0.0f;
+
+        for (int a = 0; a < channels; a++)
+        {
+            for (int b = 0; b < channels; b++)
+                next[a] += covariance[a][b] * axis[b];
+            length += next[a] * next[a];
+        }
+
+        length = std::sqrt(length);
+        for (int c = 0; c < channels; c++)
+            axis[c] = length > 1e-6f ? next[c] / length : 0.0f;
+    }
+}
+
+// The extremes of the points along their principal axis, pulled in by
+// inset of the range - the palette then lands closer to the bulk of the block
+static void AxisEndpoints(const float* points, int count, int channels, float inset, float* low, float* high)
+{
+    float mean[4];
+    float axis[4];
+    PrincipalAxis(points, count, channels, mean, axis);
+
+    float minimum = 0.0f;
+    float maximum = 0.0f;
+    for (int i = 0; i < count; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++)
+            t += (points[i * channels + c] - mean[c]) * axis[c];
+
+        minimum = std::min(minimum, t);
+        maximum = std::max(maximum, t);
+    }
+
+    float pull = (maximum - minimum) * inset;
+    minimum += pull;
+    maximum -= pull;
+
+    for (int c = 0; c < channels; c++)
+    {
+        low[c] = std::min(std::max(mean[c] + axis[c] * minimum, 0.0f), 255.0f);
+        high[c] = std::min(std::max(mean[c] + axis[c] * maximum, 0.0f), 255.0f);
+    }
+}
+
+// Index of the palette entry nearest each point, by squared distance
+static void NearestIndices(const float* points, int count, int channels, const float* palette, int entries, int* indices)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float best = 1e30f;
+        for (int e = 0; e < entries; e++)
+        {
+            float distance = 0.0f;
+            for (int c = 0; c < channels; c++)
+            {
+                float d = points[i * channels + c] - palette[e * channels + c];
+                distance += d * d;
+            }
+
+            if (distance < best)
+            {
+                best = distance;
+                indices[i] = e;
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BC1 / BC4
+// -----------------------------------------------------------------------------
+static uint16_t To565(const float* colour)
+{
+    int r = (int)std::lround(colour[0] * 31.0f / 255.0f);
+    int g = (int)std::lround(colour[1] * 63.0f / 255.0f);
+    int b = (int)std::lround(colour[2] * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void From565(uint16_t value, float* colour)
+{
+    int r = (value >> 11) & 31;
+    int g = (value >> 5) & 63;
+    int b = value & 31;
+    colour[0] = (float)((r << 3) | (r >> 2));
+    colour[1] = (float)((g << 2) | (g >> 4));
+    colour[2] = (float)((b << 3) | (b >> 2));
+}
+
+// Always the four-colour mode (colour0 > colour1), which is also the only
+// one BC3's colour half has
+void CompressBlockBC1(const unsigned char* block, unsigned char* out)
+{
+    float points[16 * 3];
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            points[i * 3 + c] = block[i * 4 + c];
+    }
+
+    float low[3];
+    float high[3];
+    AxisEndpoints(points, 16, 3, 1.0f / 16.0f, low, high);
+
+    uint16_t colour0 = To565(high);
+    uint16_t colour1 = To565(low);
+    if (colour0 < colour1)
+        std::swap(colour0, colour1);
+
+    int indices[16] = {};
+    if (colour0 != colour1)
+    {
+        float palette[4 * 3];
+        From565(colour0, &palette[0]);
+        From565(colour1, &palette[3]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[6 + c] = (2.0f * palette[c] + palette[3 + c]) / 3.0f;
+            palette[9 + c] = (palette[c] + 2.0f * palette[3 + c]) / 3.0f;
+        }
+
+        NearestIndices(points, 16, 3, palette, 4, indices);
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++)
+        bits |= (uint32_t)indices[i] << (i * 2);
+
+    out[0] = (unsigned char)(colour0 & 0xFF);
+    out[1] = (unsigned char)(colour0 >> 8);
+    out[2] = (unsigned char)(colour1 & 0xFF);
+    out[3] = (unsigned char)(colour1 >> 8);
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (unsigned char)(bits >> (i * 8));
+}
+
+// One channel of the RGBA block into 8 bytes, eight-value mode
+static void CompressBlockBC4(const unsigned char* block, int channel, unsigned char* out)
+{
+    float points[16];
+    int low = 255;
+    int high = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int value = block[i * 4 + channel];
+        points[i] = (float)value;
+        low = std::min(low, value);
+        high = std::max(high, value);
+    }
+
+    int indices[16] = {};
+    if (high != low)
+    {
+        float palette[8];
+        palette[0] = (float)high;
+        palette[1] = (float)low;
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = ((7 - i) * high + i * low) / 7.0f;
+
+        NearestIndices(points, 16, 1, palette, 8, indices);
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++)
+        bits |= (uint64_t)indices[i] << (i * 3);
+
+    out[0] = (unsigned char)high;
+    out[1] = (unsigned char)low;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (unsigned char)(bits >> (i * 8));
+}
+
+void CompressBlockBC3(const unsigned char* block, unsigned char* out)
+{
+    CompressBlockBC4(block, 3, out);
+    CompressBlockBC1(block, out + 8);
+}
+
+// -----------------------------------------------------------------------------
+// BC7 MODE 6
+//
+// bits 0-6 mode (1 << 6), then 7 bits each of R0 R1 G0 G1 B0 B1 A0 A1, a
+// p-bit per endpoint (the shared low bit of its four channels), then sixteen
+// 4-bit indices - the first one 3 bits, its top bit implied zero.
+// -----------------------------------------------------------------------------
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static void PutBits(unsigned char* out, int& position, uint32_t value, int count)
+{
+    for (int bit = 0; bit < count; bit++, position++)
+        out[position >> 3] |= (unsigned char)(((value >> bit) & 1) << (position & 7));
+}
+
+// Nearest 7-bit value plus p-bit for one RGBA endpoint
+static void QuantiseEndpoint(const float* endpoint, int* quantised, int& pbit)
+{
+    float bestError = 1e30f;
+
+    for (int p = 0; p < 2; p++)
+    {
+        int candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++)
+        {
+            candidate[c] = std::min(std::max((int)std::lround((endpoint[c] - p) / 2.0f), 0), 127);
+            float d = (float)((candidate[c] << 1) | p) - endpoint[c];
+            error += d * d;
+        }
+
+        if (error < bestError)
+        {
+            bestError = error;
+            pbit = p;
+            std::memcpy(quantised, candidate, sizeof(candidate));
+        }
+    }
+}
+
+void CompressBlockBC7(const unsigned char* block, unsigned char* out)
+{
+    float points[16 * 4];
+    for (int i = 0; i < 64; i++)
+        points[i] = block[i];
+
+    float endpoints[2][4];
+    AxisEndpoints(points, 16, 4, 0.0f, endpoints[0], endpoints[1]);
+
+    int quantised[2][4];
+    int pbits[2];
+    QuantiseEndpoint(endpoints[0], quantised[0], pbits[0]);
+    QuantiseEndpoint(endpoints[1], quantised[1], pbits[1]);
+
+    float palette[16 * 4];
+    for (int e = 0; e < 16; e++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            int from = (quantised[0][c] << 1) | pbits[0];
+            int to = (quantised[1][c] << 1) | pbits[1];
+            palette[e * 4 + c] = (float)(((64 - BC7_WEIGHTS[e]) * from + BC7_WEIGHTS[e] * to + 32) >> 6);
+        }
+    }
+
+    int indices[16] = {};
+    NearestIndices(points, 16, 4, palette, 16, indices);
+
+    // The first index has no top bit - swap the ends to make it zero
+    if (indices[0] & 8)
+    {
+        std::swap(quantised[0], quantised[1]);
+        std::swap(pbits[0], pbits[1]);
+        for (int i = 0; i < 16; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    std::memset(out, 0, 16);
+    int position = 0;
+    PutBits(out, position, 1u << 6, 7);
+
+    for (int c = 0; c < 4; c++)
+    {
+        PutBits(out, position, (uint32_t)quantised[0][c], 7);
+        PutBits(out, position, (uint32_t)quantised[1][c], 7);
+    }
+
+    PutBits(out, position, (uint32_t)pbits[0], 1);
+    PutBits(out, position, (uint32_t)pbits[1], 1);
+
+    PutBits(out, position, (uint32_t)indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        PutBits(out, position, (uint32_t)indices[i], 4);
+}
+
+// -----------------------------------------------------------------------------
+// MIP CHAIN
+// -----------------------------------------------------------------------------
+
+// 2x2 box filter; an odd last row or column is folded into its neighbour
+static void Downsample(const std::vector<unsigned char>& source, int width, int height,
+    std::vector<unsigned char>& target, int& targetWidth, int& targetHeight)
+{
+    targetWidth = std::max(width / 2, 1);
+    targetHeight = std::max(height / 2, 1);
+    target.assign((size_t)targetWidth * targetHeight * 4, 0);
+
+    for (int y = 0; y < targetHeight; y++)
+    {
+        int y0 = std::min(y * 2, height - 1);
+        int y1 = std::min(y * 2 + 1, height - 1);
+
+        for (int x = 0; x < targetWidth; x++)
+        {
+            int x0 = std::min(x * 2, width - 1);
+            int x1 = std::min(x * 2 + 1, width - 1);
+
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = source[((size_t)y0 * width + x0) * 4 + c] + source[((size_t)y0 * width + x1) * 4 + c]
+                    + source[((size_t)y1 * width + x0) * 4 + c] + source[((size_t)y1 * width + x1) * 4 + c];
+                target[((size_t)y * targetWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+static void CompressLevel(const std::vector<unsigned char>& rgba, int width, int height, TextureCompression format,
+    unsigned char* out)
+{
+    size_t blockBytes = CompressedBlockBytes(format);
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+
+    unsigned char block[64];
+    for (int by = 0; by < blocksY; by++)
+    {
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            // Edge blocks repeat the last row and column
+            for (int i = 0; i < 16; i++)
+            {
+                int x = std::min(bx * 4 + (i & 3), width - 1);
+                int y = std::min(by * 4 + (i >> 2), height - 1);
+                std::memcpy(&block[i * 4], &rgba[((size_t)y * width + x) * 4], 4);
+            }
+
+            switch (format)
+            {
+            case TextureCompression::BC1: CompressBlockBC1(block, out); break;
+            case TextureCompression::BC3: CompressBlockBC3(block, out); break;
+            case TextureCompression::BC7: CompressBlockBC7(block, out); break;
+            default: break;
+            }
+
+            out += blockBytes;
+        }
+    }
+}
+
+void CompressTexture(const unsigned char* rgba, int width, int height, TextureCompression format,
+    CompressedImage& image, std::vector<unsigned char>& data)
+{
+    image = CompressedImage();
+    image.format = format;
+
+    size_t blockBytes = CompressedBlockBytes(format);
+    if (blockBytes == 0 || width <= 0 || height <= 0)
+        return;
+
+    std::vector<unsigned char> level(rgba, rgba + (size_t)width * height * 4);
+    std::vector<unsigned char> next;
+
+    while (true)
+    {
+        CompressedLevel compressed;
+        compressed.width = width;
+        compressed.height = height;
+        compressed.offset = data.size();
+        compressed.size = (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+
+        data.resize(data.size() + compressed.size);
+        CompressLevel(level, width, height, format, &data[compressed.offset]);
+        image.levels.push_back(compressed);
+
+        if (width == 1 && height == 1)
+            break;
+
+        Downsample(level, width, height, next, width, height);
+        level.swap(next);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+// S3TC is an extension, so the core-only glad header leaves these out
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// -----------------------------------------------------------------------------
+// BLOCK COMPRESSION
+//
+// Turns an RGBA8 image into a full mip chain of 4x4 blocks the GPU samples
+// directly:
+//
+//   BC1   RGB,  8 bytes a block (4 bpp)   opaque colour
+//   BC3   RGBA, 16 bytes (8 bpp)          colour with alpha (BC1 colour + BC4 alpha)
+//   BC7   RGBA, 16 bytes (8 bpp)          higher quality colour - mode 6 only,
+//                                         one endpoint pair per block
+//
+// Endpoints come from the block's principal axis, so the encoders are single
+// pass and fast enough to run at load time, not just offline. Levels smaller
+// than a block are padded by repeating their edge texels.
+// -----------------------------------------------------------------------------
+enum class TextureCompression
+{
+    None,
+    BC1,
+    BC3,
+    BC7
+};
+
+struct CompressedLevel
+{
+    int width = 0;
+    int height = 0;
+    size_t offset = 0;     // into whatever holds the image's bytes
+    size_t size = 0;
+};
+
+struct CompressedImage
+{
+    TextureCompression format = TextureCompression::None;
+    std::vector<CompressedLevel> levels;    // level 0 first
+};
+
+size_t CompressedBlockBytes(TextureCompression format);
+GLenum CompressedInternalFormat(TextureCompression format);
+
+// Builds every mip level of the width x height RGBA8 image and appends the
+// compressed levels to data, level 0 first. The level offsets are into data.
+void CompressTexture(const unsigned char* rgba, int width, int height, TextureCompression format,
+    CompressedImage& image, std::vector<unsigned char>& data);
+
+// Single 4x4 blocks, 64 bytes of RGBA8 in row order
+void CompressBlockBC1(const unsigned char* block, unsigned char* out);
+void CompressBlockBC3(const unsigned char* block, unsigned char* out);
+void CompressBlockBC7(const unsigned char* block, unsigned char* out);